@@ -0,0 +1,55 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DPLIB_BAND_CHOLESKY_HPP
+#define DPLIB_BAND_CHOLESKY_HPP
+
+#include <Eigen/Core>
+#include <cstddef>
+#include <vector>
+#include "lib/sparse_matrix.hpp"
+
+namespace dplib{
+
+// Banded Cholesky through LAPACK (dpbtrf/dpbtrs). Relies on the DOF
+// numbering being band-limited, which the reverse Cuthill-McKee ordering
+// in RectangularMesh takes care of. Cost is O(n*kd^2), so it pays off on
+// long, narrow meshes, where kd is close to the smaller dimension.
+class BandCholesky{
+    public:
+    void set_K(SparseMatrix& M, size_t L);
+    void compute();
+    void solve(std::vector<double>& x, std::vector<double>& b);
+    // One right-hand side per column, all solved in a single dpbtrs call
+    void solve(Eigen::MatrixXd& X, const Eigen::MatrixXd& B) const;
+
+    inline size_t bandwidth() const{
+        return this->kd;
+    }
+
+    private:
+    size_t n = 0;
+    size_t kd = 0;
+    std::vector<double> band;
+};
+
+}
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DPLIB_CONDITION_HPP
+#define DPLIB_CONDITION_HPP
+
+#include <Eigen/Core>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include "lib/linear_operator.hpp"
+#include "lib/sparse_matrix.hpp"
+
+namespace dplib{
+
+// Estimates of the extreme eigenvalues and condition number of a
+// symmetric positive definite matrix, without any dense eigensolver
+struct ConditionEstimate{
+    double lambda_min = 0;
+    double lambda_max = 0;
+    // lambda_max/lambda_min, except for hager_condition(), where it is the
+    // 1-norm condition number
+    double condition = 0;
+    // Lanczos or CG steps, or solves for hager_condition()
+    size_t steps = 0;
+
+    std::string to_string() const;
+};
+
+// Ritz values of `steps` Lanczos iterations from a fixed pseudo-random
+// start. There is no reorthogonalization: lost orthogonality only brings
+// copies of converged Ritz values, not wrong extremes. lambda_max
+// converges fast, lambda_min needs about as many steps as CG does to
+// solve with K.
+ConditionEstimate lanczos_condition(const LinearOperator& A, size_t steps = 200);
+// Of the lower triangle stored in M
+ConditionEstimate lanczos_condition(const SparseMatrix& M, size_t L, size_t steps = 200);
+
+// Ritz values of the Lanczos matrix that (P)CG builds implicitly, from
+// its step lengths alpha and direction updates beta (beta[j] is the one
+// following alpha[j]). With a preconditioner M these are eigenvalues of
+// M^-1*K, so an IdentityPreconditioner gives those of K. Only the modes
+// present in the initial residual are seen: lambda_min is overestimated
+// when the right-hand side hardly excites the smallest ones.
+ConditionEstimate cg_condition(const std::vector<double>& alpha, const std::vector<double>& beta);
+
+// Hager's (Higham's refined) 1-norm estimate, from a few products with A
+// for ||A||_1 and a few solves with a factorization for ||A^-1||_1. Both
+// are symmetric, so no transposed solves are needed. The bounds
+// lambda_max <= ||A||_1 and lambda_min >= 1/||A^-1||_1 are returned as
+// the eigenvalues.
+ConditionEstimate hager_condition(const LinearOperator& A, const std::function<void(const Eigen::VectorXd&, Eigen::VectorXd&)>& solve, size_t max_steps = 5);
+
+}
+
+#endif
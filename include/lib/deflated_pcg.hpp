@@ -0,0 +1,113 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DPLIB_DEFLATED_PCG_HPP
+#define DPLIB_DEFLATED_PCG_HPP
+
+#include <Eigen/Core>
+#include <Eigen/Cholesky>
+#include <Eigen/SparseCore>
+#include <cstddef>
+#include <vector>
+#include "lib/linear_operator.hpp"
+#include "lib/preconditioner.hpp"
+#include "lib/sparse_matrix.hpp"
+
+namespace dplib{
+
+// PCG with deflation of a coarse subspace (Saad, Yeung, Erhel and Guyomarc'h;
+// Vuik et al. for high-contrast problems).
+//
+// Regions of high density that are only weakly coupled to the rest (such
+// as the inside of the ring) give K eigenvalues of the order of the low
+// density, which plain PCG takes many iterations to resolve. Their
+// eigenvectors are close to constant on each region, so the iterates
+// are kept K-orthogonal to the indicator vectors Z of those regions: the
+// coarse operator E = Z^T*K*Z is factored once in compute(), and each
+// iteration projects the search direction with one coarse solve.
+//
+// The deflation vectors are piecewise constant with disjoint supports,
+// given as a group index per DOF (see RectangularMesh::deflation_groups()).
+class DeflatedPCG{
+    public:
+    typedef Eigen::SparseMatrix<double, Eigen::ColMajor, std::ptrdiff_t> Mat;
+
+    // Not copied if all entries of M are in its compressed pattern, in
+    // which case M must outlive the solve
+    void set_K(SparseMatrix& M, size_t L);
+    // Matrix-free operator, must outlive the solver
+    void set_K(const LinearOperator& A);
+    // Defaults to Jacobi, must outlive the solver
+    inline void set_preconditioner(Preconditioner* P){
+        this->P = P;
+    }
+    // Of the product with an assembled K
+    inline void set_storage(SpMV::Storage storage){
+        this->sparse_op.set_storage(storage);
+    }
+    // DOF i is in deflation vector group[i], or in none if negative
+    void set_deflation(const std::vector<long>& group);
+    // Relative residual
+    inline void set_tolerance(double tol){
+        this->tol = tol;
+    }
+    inline void set_max_iterations(size_t it){
+        this->max_it = it;
+    }
+    void compute();
+    void solve(std::vector<double>& x, std::vector<double>& b);
+    void solve(Eigen::VectorXd& x, const Eigen::VectorXd& b);
+
+    inline size_t iterations() const{
+        return this->it;
+    }
+    inline double error() const{
+        return this->err;
+    }
+    inline size_t deflation_size() const{
+        return this->m;
+    }
+
+    private:
+    Mat K;
+    SparseOperator sparse_op;
+    const LinearOperator* A = nullptr;
+    JacobiPreconditioner jacobi;
+    Preconditioner* P = nullptr;
+    std::vector<long> group;
+    size_t m = 0;
+    // K*Z, sparse since Z is
+    Mat KZ;
+    Eigen::LDLT<Eigen::MatrixXd> E;
+    double tol = Eigen::NumTraits<double>::epsilon();
+    size_t max_it = 0;
+    size_t it = 0;
+    double err = 0;
+
+    void build_KZ();
+    // Z^T*v
+    Eigen::VectorXd restrict(const Eigen::VectorXd& v) const;
+    // v -= Z*mu
+    void subtract_prolonged(const Eigen::VectorXd& mu, Eigen::VectorXd& v) const;
+};
+
+}
+
+#endif
@@ -0,0 +1,177 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef DPLIB_DISTRIBUTED_MESH_HPP
+#define DPLIB_DISTRIBUTED_MESH_HPP
+
+#include <Eigen/Core>
+#include <Eigen/Cholesky>
+#include <Eigen/SparseCore>
+#include <cstddef>
+#include <mpi.h>
+#include <vector>
+#include "lib/eigen.hpp"
+#include "lib/mesh.hpp"
+
+namespace dplib{
+
+// MPI version of the RectangularMesh pipeline, for meshes that do not fit
+// in the memory of one node.
+//
+// The (H+1) rows of nodes of the W x H grid are split into contiguous
+// blocks, one per rank. Each rank assembles the rows of K of its own
+// nodes, recomputing the row of elements below them instead of
+// communicating, and only keeps the boundary conditions and vectors of
+// its rows plus a halo of neighbouring rows. Dirichlet nodes become
+// identity rows, with their columns moved to the load vector, so that K
+// stays symmetric.
+//
+// The system is solved by PCG, the products exchanging one row of nodes
+// with each neighbour. The preconditioner is Jacobi, or additive Schwarz
+// with one subdomain per rank (its rows grown by `overlap` rows of nodes
+// on each side, factored by an EigenCholesky) plus a coarse space of one
+// constant per rank.
+//
+// Nodes are numbered naturally (x + y*(W+1)) and the boundaries take the
+// same arguments as RectangularMesh's, so the results match its own.
+class DistributedMesh{
+    public:
+    DistributedMesh(MPI_Comm comm, size_t W, size_t H, double t, double elem_size);
+
+    // Node range
+    void apply_Dirichlet(double d, Point begin, Point end);
+    // Node range
+    void apply_Neumann(double d, Point begin, Point end);
+    void generate_K(const double K_MIN);
+    void solve();
+
+    // Relative residual
+    inline void set_tolerance(double tol){
+        this->tol = tol;
+    }
+    inline void set_max_iterations(size_t it){
+        this->max_it = it;
+    }
+    inline void set_schwarz(bool enable){
+        this->schwarz = enable;
+    }
+    // Rows of nodes added to each side of a Schwarz subdomain, at most
+    // the rows of the smallest block. Takes effect on generate_K().
+    inline void set_overlap(size_t overlap){
+        this->overlap = overlap;
+    }
+    inline void set_coarse_space(bool enable){
+        this->coarse = enable;
+    }
+    inline size_t iterations() const{
+        return this->it;
+    }
+    inline double error() const{
+        return this->err;
+    }
+
+    // Element averages of psi, as RectangularMesh::get_result(), gathered
+    // on rank 0 (empty on the others)
+    std::vector<double> get_result();
+
+    inline int rank() const{
+        return this->id;
+    }
+    inline int size() const{
+        return this->ranks;
+    }
+    inline size_t local_rows() const{
+        return this->y1 - this->y0;
+    }
+
+    private:
+    typedef Eigen::SparseMatrix<double, Eigen::RowMajor, std::ptrdiff_t> RowMat;
+
+    struct Boundary{
+        double d;
+        Point begin, end;
+    };
+
+    MPI_Comm comm;
+    int id, ranks;
+    const size_t W, H;
+    const double element_size;
+    const double t;
+    // First row of nodes of each rank (and H+1 at the end)
+    std::vector<size_t> row_begin;
+    // Own rows of nodes [y0, y1), and the window [w0, w1) of rows kept
+    // locally, which includes the halo
+    size_t y0, y1, w0, w1;
+    std::vector<Boundary> dirichlet, neumann;
+
+    // Over the window: Dirichlet value of each node, and whether it is one
+    std::vector<double> fixed_value;
+    std::vector<char> fixed;
+    // Own rows by window columns
+    RowMat K;
+    Eigen::VectorXd load;
+    // Over the window
+    Eigen::VectorXd psi;
+
+    double tol = 1e-10;
+    size_t max_it = 0;
+    size_t it = 0;
+    double err = 0;
+
+    Eigen::VectorXd inv_diag;
+    bool schwarz = false;
+    size_t overlap = 1;
+    bool coarse = true;
+    // Rows [s0, s1) of the Schwarz subdomain
+    size_t s0 = 0, s1 = 0;
+    EigenCholesky local;
+    Eigen::LDLT<Eigen::MatrixXd> E;
+
+    inline size_t nodes(size_t rows) const{
+        return rows*(this->W+1);
+    }
+    // Window position of the first node of row y
+    inline size_t offset(size_t y) const{
+        return this->nodes(y - this->w0);
+    }
+    double ring(const Point& p, double min) const;
+    void mark_dirichlet();
+    // Calls f(y, n, M) for each element of the rows [e0, e1), with n the
+    // grid nodes of the element and M its scaled element matrix
+    template<typename F>
+    void for_each_element(size_t e0, size_t e1, const std::vector<double>& k, double K_MIN, F f) const;
+    void setup_schwarz(const std::vector<double>& k, double K_MIN);
+
+    // Fills `rows` rows of v (over the window) on each side of the own
+    // rows with the neighbours' values
+    void exchange(Eigen::VectorXd& v, size_t rows) const;
+    // Adds the `rows` halo rows on each side of v to the neighbours' own
+    // rows, reverse of exchange()
+    void accumulate(Eigen::VectorXd& v, size_t rows) const;
+    double dot(const Eigen::VectorXd& a, const Eigen::VectorXd& b) const;
+    // y = K*x, x over the window (halo updated here), y over the own rows
+    void multiply(Eigen::VectorXd& x, Eigen::VectorXd& y) const;
+    void precondition(const Eigen::VectorXd& r, Eigen::VectorXd& z) const;
+};
+
+}
+
+#endif
@@ -27,6 +27,16 @@
 #include <Eigen/src/OrderingMethods/Ordering.h>
 #include <Eigen/src/SparseCholesky/SimplicialCholesky.h>
 #include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "lib/condition.hpp"
+#include "lib/level_schedule.hpp"
+#include "lib/linear_operator.hpp"
+#include "lib/preconditioner.hpp"
 #include "lib/sparse_matrix.hpp"
 
 namespace dplib{
@@ -35,38 +45,278 @@ class EigenPCG{
     public:
     typedef Eigen::SparseMatrix<double, Eigen::ColMajor, std::ptrdiff_t> Mat;
 
+    // Not copied if all entries of M are in its compressed pattern, in
+    // which case M must outlive the solve
     void set_K(SparseMatrix& M, size_t L);
+    // Matrix-free operator, must outlive the solver
+    void set_K(const LinearOperator& A);
+    // Defaults to Jacobi, must outlive the solver
+    inline void set_preconditioner(Preconditioner* P){
+        this->P = P;
+    }
+    // Of the product with an assembled K
+    inline void set_storage(SpMV::Storage storage){
+        this->sparse_op.set_storage(storage);
+    }
+    // Relative residual
+    inline void set_tolerance(double tol){
+        this->cg.setTolerance(tol);
+    }
+    inline void set_max_iterations(size_t it){
+        this->cg.setMaxIterations(it);
+    }
+    // Estimates the extreme eigenvalues of the preconditioned operator
+    // from the CG coefficients of each solve (see cg_condition()), and
+    // logs them. Costs no extra products, but the solve then runs its
+    // own CG loop (same iterations as Eigen's) to record them.
+    inline void set_condition_estimation(bool enable){
+        this->estimate_condition = enable;
+    }
+    // Called with the iteration number and the iterate after each step
+    // (e.g. to pass it to a FrameRecorder), which also makes the solve
+    // run its own CG loop
+    typedef std::function<void(size_t, const Eigen::VectorXd&)> IterationCallback;
+    inline void set_iteration_callback(IterationCallback callback){
+        this->callback = std::move(callback);
+    }
+    void compute();
+    void solve(std::vector<double>& x, std::vector<double>& b);
+
+    inline size_t iterations() const{
+        return this->own_loop() ? this->it : this->cg.iterations();
+    }
+    inline double error() const{
+        return this->own_loop() ? this->err : this->cg.error();
+    }
+    // Of the last solve, if enabled
+    inline const ConditionEstimate& get_condition() const{
+        return this->condition;
+    }
+
+    private:
+    bool estimate_condition = false;
+    IterationCallback callback;
+    size_t it = 0;
+    double err = 0;
+    ConditionEstimate condition;
+    Mat K;
+    SparseOperator sparse_op;
+    const LinearOperator* A = nullptr;
+    JacobiPreconditioner jacobi;
+    Preconditioner* P = nullptr;
+    OperatorWrapper op;
+    Eigen::ConjugateGradient<OperatorWrapper, Eigen::Lower|Eigen::Upper, PreconditionerWrapper> cg;
+
+    inline bool own_loop() const{
+        return this->estimate_condition || this->callback;
+    }
+    // Eigen's PCG, also recording the coefficients and calling the
+    // callback
+    void solve_recording(Eigen::VectorXd& x, const Eigen::VectorXd& b);
+};
+
+// The ordering and symbolic analysis are only done on the first call to
+// compute() (or after reset()). As long as the sparsity pattern of the
+// SparseMatrix does not change, later calls to set_K() only refill the
+// values in place and compute() only redoes the numeric factorization.
+//
+// A SparseMatrix with all of its entries in the compressed pattern is not
+// copied: K is read from it during compute(), so it must not be changed
+// in between.
+//
+// When only a few element contributions of K change, they can be passed
+// to modify() and the next compute() updates the current factor instead
+// of redoing it (rank-one updates and downdates of L*D*L^T along the
+// paths of the elimination tree, as in CHOLMOD's updown).
+class EigenCholesky{
+    public:
+    typedef Eigen::SparseMatrix<double, Eigen::ColMajor, std::ptrdiff_t> Mat;
+    typedef Eigen::Map<const Mat> MatMap;
+
+    // Accumulated wall time, in seconds
+    struct Timings{
+        double symbolic = 0;
+        double numeric = 0;
+        double solve = 0;
+        double update = 0;
+        size_t symbolic_calls = 0;
+        size_t numeric_calls = 0;
+        size_t solve_calls = 0;
+        size_t update_calls = 0;
+    };
+
+    void set_K(SparseMatrix& M, size_t L);
+    // Lower triangle is used
+    void set_K(const Mat& K);
     void compute();
     void solve(std::vector<double>& x, std::vector<double>& b);
+    void solve(Eigen::VectorXd& x, const Eigen::VectorXd& b) const;
+    // One right-hand side per column. The triangular solves go through the
+    // factor once for the whole block instead of once per column.
+    void solve(Eigen::MatrixXd& X, const Eigen::MatrixXd& B) const;
+    // Records that the symmetric W x W matrix M (row-major) was added to K
+    // on the DOFs pos, negative ones being skipped (Dirichlet nodes). K
+    // itself must be changed by the caller too. M is split into one
+    // rank-one term per nonzero eigenvalue, and the next compute() applies
+    // them to the current factor, unless there are more than the update
+    // limit in total, the pattern changed or a downdate fails, in which
+    // case it refactors.
+    void modify(const std::vector<long>& pos, const std::vector<double>& M);
+    // Largest total rank of the modifications applied as updates. With 0
+    // (the default) the limit comes from the factor itself: each rank-one
+    // term costs about the size of the columns of L on the path of the
+    // elimination tree, and the updates are applied as long as that adds
+    // up to less than a full factorization.
+    inline void set_update_limit(size_t rank){
+        this->update_limit = rank;
+    }
+
+    // Estimates the 1-norm condition number of K after each factorization
+    // or update with hager_condition() (about ten solves), and logs it
+    inline void set_condition_estimation(bool enable){
+        this->estimate_condition = enable;
+    }
+    // Of the last factorization, if enabled
+    inline const ConditionEstimate& get_condition() const{
+        return this->condition;
+    }
 
     inline void reset(){
         this->first_time = true;
     }
+    // Runs the triangular solves level by level in parallel (see
+    // LevelSchedule). Takes effect on the next compute().
+    inline void set_level_scheduling(bool enable){
+        this->level_scheduling = enable;
+        this->scheduled = false;
+    }
+    // Levels of the current factor, if level scheduling is enabled
+    inline const LevelSchedule& get_schedule() const{
+        return this->schedule;
+    }
+    inline const Timings& get_timings() const{
+        return this->timings;
+    }
+    void print_timings() const;
 
     private:
+    // Gives access to the factor, for the low-rank modifications
+    class LDLT : public Eigen::SimplicialLDLT<MatMap, Eigen::Lower, Eigen::AMDOrdering<std::ptrdiff_t>>{
+        public:
+        // Position of DOF i in the factor
+        inline std::ptrdiff_t position(std::ptrdiff_t i) const{
+            return (this->m_P.size() > 0) ? this->m_P.indices()[i] : i;
+        }
+        // L*D*L^T += sum_c sigma[c]*w_c*w_c^T, with the k vectors stored
+        // row-major in w (n x k, permuted numbering) and nonzero only on
+        // the path of the elimination tree starting at first. Any set of
+        // DOFs coupled in K lies on the path from its first one. The
+        // vectors are processed together, one column of L at a time, and
+        // w is left zeroed. False if a pivot becomes non-positive, in which
+        // case the factor is no longer valid.
+        bool update(double* w, std::ptrdiff_t k, const double* sigma, std::ptrdiff_t first);
+        // Flops of one rank-one term starting at first, roughly
+        double update_cost(std::ptrdiff_t first) const;
+        // Flops of the numeric factorization, roughly
+        double factor_cost() const;
+    };
+    // One element change, as V*diag(sigma)*V^T on the DOFs pos
+    struct Modification{
+        std::vector<long> pos;
+        Eigen::MatrixXd V;
+        Eigen::VectorXd sigma;
+    };
+
     bool first_time = true;
+    bool estimate_condition = false;
+    ConditionEstimate condition;
+    Timings timings;
+    // Own copy, when K can't be mapped
     Mat K;
-    Eigen::ConjugateGradient<Mat, Eigen::Lower|Eigen::Upper> cg;
+    // Either K or the arrays of source. A Map can't be reassigned, so it is
+    // rebuilt by emplace().
+    std::optional<MatMap> K_map;
+    const SparseMatrix* source = nullptr;
+    size_t revision = 0;
+    LDLT solver;
+    std::vector<Modification> modifications;
+    size_t pending_rank = 0;
+    size_t update_limit = 0;
+    std::vector<double> work;
+    bool level_scheduling = false;
+    // The schedule matches the current factor
+    bool scheduled = false;
+    LevelSchedule schedule;
+
+    void map_K();
+    void update_condition();
+    // Whether the pending modifications are cheaper than refactoring
+    bool worth_updating() const;
+    // Applies the pending modifications to the factor, updates before
+    // downdates
+    bool update_factor();
+    // Solves with L*D*L^T through the schedule, in place, on k permuted
+    // right-hand sides stored row-major
+    void solve_scheduled(double* y, std::ptrdiff_t k) const;
 };
 
-class EigenCholesky{
+// Factors a diagonally scaled copy of K in single precision (with 32-bit
+// indices, so the factor takes half the memory of EigenCholesky's) and
+// recovers double precision accuracy with iterative refinement against
+// the original K. If refinement converges too slowly, the float factor is
+// used as a preconditioner for CG instead.
+//
+// Falls back to a double precision factorization when the float one is
+// not reliable: non-positive or tiny pivots during factorization, or no
+// convergence during the solve. The fallback is kept until reset().
+class MixedCholesky{
     public:
     typedef Eigen::SparseMatrix<double, Eigen::ColMajor, std::ptrdiff_t> Mat;
+    typedef Eigen::SparseMatrix<float, Eigen::ColMajor, int> FloatMat;
 
     void set_K(SparseMatrix& M, size_t L);
+    // Lower triangle is used
+    void set_K(const Mat& K);
     void compute();
     void solve(std::vector<double>& x, std::vector<double>& b);
+    void solve(Eigen::VectorXd& x, const Eigen::VectorXd& b);
 
+    // Componentwise backward error, max |r_i|/(|K||x| + |b|)_i. The weakly
+    // coupled regions of a high contrast problem are invisible to a
+    // normwise residual.
+    inline void set_tolerance(double tol){
+        this->tol = tol;
+    }
     inline void reset(){
         this->first_time = true;
+        this->use_double = false;
+    }
+    inline bool using_double() const{
+        return this->use_double;
+    }
+    // Refinement steps plus CG iterations of the last solve
+    inline size_t iterations() const{
+        return this->it;
     }
 
     private:
     bool first_time = true;
+    bool use_double = false;
+    double tol = 1e-14;
+    size_t it = 0;
     Mat K;
-    Eigen::SimplicialCholesky<Mat, Eigen::Lower, Eigen::AMDOrdering<std::ptrdiff_t>> solver;
-};
+    Eigen::VectorXd scale;
+    FloatMat Kf;
+    std::unique_ptr<Eigen::SimplicialLLT<FloatMat, Eigen::Lower, Eigen::AMDOrdering<int>>> solver;
+    EigenCholesky fallback;
 
+    void switch_to_double(const std::string& reason);
+    // z ~= K^-1 r, through the float factor
+    void apply(const Eigen::VectorXd& r, Eigen::VectorXd& z) const;
+    double backward_error(const Eigen::VectorXd& x, const Eigen::VectorXd& b, const Eigen::VectorXd& r) const;
+    bool refine(Eigen::VectorXd& x, const Eigen::VectorXd& b);
+    bool cg(Eigen::VectorXd& x, const Eigen::VectorXd& b);
+};
 
 }
 
@@ -0,0 +1,132 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef DPLIB_FRAME_RECORDER_HPP
+#define DPLIB_FRAME_RECORDER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dplib{
+
+// Records snapshots of a field (e.g. psi at chosen iterations of a solve
+// or of a design loop) as the frames of a video or of an image sequence.
+//
+// record() only copies the values into a slot of a lock-free single
+// producer, single consumer ring buffer. A writer thread turns them into
+// W x H element values, colormaps them (grayscale, as Window) and writes
+// them, so the recording thread never waits on colormapping or I/O. If
+// the buffer is full, the frame is dropped and counted instead.
+//
+// A filename ending in ".y4m" writes a single YUV4MPEG2 (4:2:0) stream.
+// Anything else writes numbered images through ImageWriter::save(), with
+// the frame number before the extension ("psi.png" gives psi_000000.png,
+// psi_000001.png...).
+class FrameRecorder{
+    public:
+    // Element values of a frame from a snapshot
+    typedef std::function<std::vector<double>(const double*)> Field;
+
+    FrameRecorder(size_t W, size_t H, std::string filename, size_t capacity = 16);
+    // Writes the frames left in the buffer
+    ~FrameRecorder();
+
+    FrameRecorder(const FrameRecorder&) = delete;
+    FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+    // Snapshots of n values (e.g. the DOFs of an iterate), turned into
+    // element values by `field` on the writer thread (e.g. with
+    // RectangularMesh::get_result()), which must stay valid until
+    // close(). By default, snapshots are the W*H element values
+    // themselves. Must be set before the first record().
+    void set_field(size_t n, Field field);
+    // Only every interval-th call to record() takes a snapshot
+    inline void set_interval(size_t interval){
+        this->interval = std::max<size_t>(interval, 1);
+    }
+    // Fixed range of the colormap, instead of each frame's own
+    inline void set_range(double min, double max){
+        this->fixed_range = true;
+        this->min = min;
+        this->max = max;
+    }
+    // Of the Y4M stream
+    inline void set_frame_rate(size_t fps){
+        this->fps = fps;
+    }
+
+    // From a single thread. False if the frame was skipped by the
+    // interval or dropped because the buffer was full.
+    bool record(const double* values);
+    inline bool record(const std::vector<double>& values){
+        return this->record(values.data());
+    }
+    // Waits until every recorded frame is written
+    void close();
+
+    inline size_t recorded() const{
+        return this->head.load(std::memory_order_relaxed);
+    }
+    inline size_t dropped() const{
+        return this->drops.load(std::memory_order_relaxed);
+    }
+    inline size_t written() const{
+        return this->tail.load(std::memory_order_relaxed);
+    }
+
+    private:
+    const size_t W, H;
+    const std::string filename;
+    const size_t capacity;
+    size_t n;
+    Field field;
+    size_t interval = 1;
+    size_t calls = 0;
+    bool fixed_range = false;
+    double min = 0, max = 1;
+    size_t fps = 25;
+    bool y4m;
+
+    // Snapshot i is in slot i % capacity. head is only written by the
+    // recording thread and tail by the writer thread.
+    std::vector<std::vector<double>> slots;
+    std::atomic<size_t> head{0}, tail{0};
+    std::atomic<size_t> drops{0};
+    std::atomic<bool> closing{false};
+    std::thread writer;
+
+    std::ofstream stream;
+    std::vector<std::uint8_t> pixels;
+
+    void run();
+    void write_frame(const std::vector<double>& values, size_t frame);
+};
+
+}
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef DPLIB_IMAGE_WRITER_HPP
+#define DPLIB_IMAGE_WRITER_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dplib{
+
+// Encodes and writes RGBA images on a background thread, in the order
+// they were queued, so that the caller never waits on compression or
+// disk. The format is taken from the extension: binary PPM (P6) for
+// ".ppm", PNG (through sf::Image) otherwise.
+//
+// The thread is started on the first write() and joined by the
+// destructor, after the queue is empty.
+class ImageWriter{
+    public:
+    ImageWriter() = default;
+    ~ImageWriter();
+
+    ImageWriter(const ImageWriter&) = delete;
+    ImageWriter& operator=(const ImageWriter&) = delete;
+
+    // `rgba` has width*height*4 bytes, row by row from the top
+    void write(std::string filename, size_t width, size_t height, std::vector<std::uint8_t> rgba);
+    // Until every queued image is written
+    void wait();
+    // Encodes and writes an image on the calling thread
+    static bool save(const std::string& filename, size_t width, size_t height, const std::vector<std::uint8_t>& rgba);
+
+    private:
+    struct Image{
+        std::string filename;
+        size_t width, height;
+        std::vector<std::uint8_t> rgba;
+    };
+
+    std::deque<Image> queue;
+    std::mutex mutex;
+    std::condition_variable queued, written;
+    std::thread thread;
+    bool busy = false;
+    bool stop = false;
+
+    void run();
+};
+
+}
+
+#endif
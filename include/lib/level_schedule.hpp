@@ -0,0 +1,99 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef DPLIB_LEVEL_SCHEDULE_HPP
+#define DPLIB_LEVEL_SCHEDULE_HPP
+
+#include <Eigen/SparseCore>
+#include <cstddef>
+#include <vector>
+
+namespace dplib{
+
+// Level-set scheduling of the triangular solves with a sparse unit lower
+// triangular factor L (as in L*D*L^T).
+//
+// Row i of L*y = b can be solved once every row it depends on is, so the
+// rows are grouped into levels of mutually independent rows. The levels
+// are run in order, each one split among the OpenMP threads. The forward
+// solve goes through the rows of L and the backward solve through its
+// columns, so both only gather and no two threads write to the same entry.
+class LevelSchedule{
+    public:
+    typedef Eigen::SparseMatrix<double, Eigen::ColMajor, std::ptrdiff_t> Mat;
+
+    // Pattern and levels
+    void analyze(const Mat& L);
+    // New values of L, same pattern
+    void update(const Mat& L);
+
+    // In place, on k right-hand sides stored row-major (k = 1 for a single
+    // vector). Diagonal entries of L are ignored, as it is unit triangular.
+    // y = L^-1 y
+    inline void solve_forward(double* y, std::ptrdiff_t k) const{
+        this->forward.solve(y, k);
+    }
+    // y = L^-T y
+    inline void solve_backward(double* y, std::ptrdiff_t k) const{
+        this->backward.solve(y, k);
+    }
+
+    // Number of rows in each level
+    inline const std::vector<std::ptrdiff_t>& forward_levels() const{
+        return this->forward.width;
+    }
+    inline const std::vector<std::ptrdiff_t>& backward_levels() const{
+        return this->backward.width;
+    }
+    void print_statistics() const;
+
+    private:
+    // One substitution, y_i -= sum_p val[p]*y[index[p]] for each row i.
+    // The entries are copied from L in the order the rows are visited, so
+    // each level reads a contiguous part of the arrays (both sweeps
+    // together take twice the memory of L).
+    struct Sweep{
+        // Rows of each level, level l being [begin[l], begin[l+1])
+        std::vector<std::ptrdiff_t> rows;
+        std::vector<std::ptrdiff_t> begin;
+        std::vector<std::ptrdiff_t> width;
+        // Entries of rows[q] are [ptr[q], ptr[q+1])
+        std::vector<std::ptrdiff_t> ptr;
+        std::vector<std::ptrdiff_t> index;
+        std::vector<double> val;
+        // Position of each entry in L
+        std::vector<std::ptrdiff_t> source;
+
+        // Row i has the entries [ptr[i], ptr[i+1]) of entries (positions in
+        // L) and index
+        void gather(std::ptrdiff_t n, const std::ptrdiff_t* ptr, const std::ptrdiff_t* entries, const std::ptrdiff_t* index);
+        void solve(double* y, std::ptrdiff_t k) const;
+    };
+
+    Sweep forward;
+    Sweep backward;
+
+    static void group(const std::vector<std::ptrdiff_t>& level, std::vector<std::ptrdiff_t>& rows, std::vector<std::ptrdiff_t>& begin, std::vector<std::ptrdiff_t>& width);
+};
+
+}
+
+#endif
@@ -0,0 +1,154 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DPLIB_LINEAR_OPERATOR_HPP
+#define DPLIB_LINEAR_OPERATOR_HPP
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+#include <cstddef>
+#include <optional>
+#include <type_traits>
+#include "lib/spmv.hpp"
+
+namespace dplib{
+
+// Symmetric operator used by the iterative solvers
+class LinearOperator{
+    public:
+    typedef Eigen::SparseMatrix<double, Eigen::ColMajor, std::ptrdiff_t> Mat;
+    typedef Eigen::Map<const Mat> MatMap;
+
+    virtual ~LinearOperator() = default;
+
+    // y = A*x
+    virtual void apply(const Eigen::VectorXd& x, Eigen::VectorXd& y) const = 0;
+    virtual Eigen::VectorXd diagonal() const = 0;
+    // Assembled matrix (lower triangle only), if there is one
+    virtual const MatMap* matrix() const{
+        return nullptr;
+    }
+
+    inline size_t size() const{
+        return this->n;
+    }
+
+    protected:
+    size_t n = 0;
+};
+
+// Lower triangle of an assembled matrix, multiplied through SpMV. The
+// matrix is referenced, not copied.
+class SparseOperator : public LinearOperator{
+    public:
+    // Call again after changing the values of K if the storage is GENERAL
+    void set_matrix(const Mat& K);
+    void set_matrix(const MatMap& K);
+    inline void set_storage(SpMV::Storage storage){
+        this->spmv.set_storage(storage);
+    }
+
+    void apply(const Eigen::VectorXd& x, Eigen::VectorXd& y) const override;
+    Eigen::VectorXd diagonal() const override;
+    inline const MatMap* matrix() const override{
+        return this->K ? &*this->K : nullptr;
+    }
+
+    private:
+    // A Map can't be reassigned, so it is rebuilt by emplace()
+    std::optional<MatMap> K;
+    SpMV spmv;
+};
+
+class OperatorWrapper;
+
+}
+
+namespace Eigen::internal{
+
+template<>
+struct traits<dplib::OperatorWrapper> : public Eigen::internal::traits<Eigen::SparseMatrix<double>>{};
+
+}
+
+namespace dplib{
+
+// Exposes a LinearOperator to Eigen's iterative solvers as a matrix-free
+// matrix replacement
+class OperatorWrapper : public Eigen::EigenBase<OperatorWrapper>{
+    public:
+    typedef double Scalar;
+    typedef double RealScalar;
+    typedef std::ptrdiff_t StorageIndex;
+    enum{
+        ColsAtCompileTime = Eigen::Dynamic,
+        MaxColsAtCompileTime = Eigen::Dynamic,
+        IsRowMajor = false
+    };
+
+    inline Eigen::Index rows() const{
+        return this->A->size();
+    }
+    inline Eigen::Index cols() const{
+        return this->A->size();
+    }
+
+    template<typename Rhs>
+    inline Eigen::Product<OperatorWrapper, Rhs, Eigen::AliasFreeProduct> operator*(const Eigen::MatrixBase<Rhs>& x) const{
+        return Eigen::Product<OperatorWrapper, Rhs, Eigen::AliasFreeProduct>(*this, x.derived());
+    }
+
+    inline void set(const LinearOperator* A){
+        this->A = A;
+    }
+    inline const LinearOperator& get() const{
+        return *this->A;
+    }
+
+    private:
+    const LinearOperator* A = nullptr;
+};
+
+}
+
+namespace Eigen::internal{
+
+template<typename Rhs>
+struct generic_product_impl<dplib::OperatorWrapper, Rhs, SparseShape, DenseShape, GemvProduct>
+    : generic_product_impl_base<dplib::OperatorWrapper, Rhs, generic_product_impl<dplib::OperatorWrapper, Rhs>>{
+
+    typedef typename Product<dplib::OperatorWrapper, Rhs>::Scalar Scalar;
+
+    template<typename Dest>
+    static void scaleAndAddTo(Dest& dst, const dplib::OperatorWrapper& lhs, const Rhs& rhs, const Scalar& alpha){
+        Eigen::VectorXd y(lhs.rows());
+        if constexpr(std::is_same<Rhs, Eigen::VectorXd>::value){
+            lhs.get().apply(rhs, y);
+        } else {
+            const Eigen::VectorXd x(rhs);
+            lhs.get().apply(x, y);
+        }
+        dst += alpha*y;
+    }
+};
+
+}
+
+#endif
@@ -26,6 +26,7 @@
 #include <vector>
 #include "lib/eigen.hpp"
 #include "lib/sparse_matrix.hpp"
+#include "lib/stencil_operator.hpp"
 
 namespace dplib{
 
@@ -41,19 +42,89 @@ struct Point{
 };
 
 void reverse_cuthill_mckee(std::vector<size_t>& element_nodes, std::vector<size_t>& old_position_mapping, const size_t nodes_per_element, const size_t number_of_nodes);
+// Geometric nested dissection of the (W+1)x(H+1) node grid: each region is
+// split by a line of nodes across its longer side, the separator being
+// numbered after both halves
+void nested_dissection(std::vector<size_t>& element_nodes, std::vector<size_t>& old_position_mapping, const size_t W, const size_t H);
 
 class RectangularMesh{
     public:
-    RectangularMesh(size_t W, size_t H, double t, double elem_size);
+    enum class Ordering{
+        // Small bandwidth, for band solvers or a solver-side ordering
+        RCM,
+        // Low fill, to be used with a natural-ordering Cholesky
+        NESTED_DISSECTION
+    };
+
+    RectangularMesh(size_t W, size_t H, double t, double elem_size, Ordering ordering = Ordering::RCM);
 
     // Node range
     void apply_Dirichlet(double d, Point begin, Point end);
     // Node range
     void apply_Neumann(double d, Point begin, Point end);
     void generate_K(const double K_MIN);
+    // Sets up the load vector and a matrix-free K instead of assembling it
+    void generate_operator(const double K_MIN);
     void solve();
+    void solve_matrix_free(EigenPCG& solver);
+    template<typename Solver>
+    inline void solve(Solver& solver){
+        solver.set_K(this->K, this->load.size());
+
+        solver.compute();
+        solver.solve(this->psi, this->load);
+    }
+    // Load cases on the same K, one load vector per column (e.g. built
+    // from get_load() and neumann_load()), all solved at once by a solver
+    // with a blocked solve (EigenCholesky, SupernodalCholesky or
+    // BandCholesky). Column c of psi is the solution of case c.
+    template<typename Solver>
+    inline void solve(Solver& solver, const Eigen::MatrixXd& loads, Eigen::MatrixXd& psi){
+        solver.set_K(this->K, this->load.size());
+
+        solver.compute();
+        solver.solve(psi, loads);
+    }
+    // Changes the density of some elements after generate_K(), updating K
+    // and the Dirichlet terms of the load vector in place
+    void set_densities(const std::vector<size_t>& elements, const std::vector<double>& rho);
+    // Same, also passing each element change (its DOFs and the change of
+    // its element matrix) to solver.modify(), so that an EigenCholesky
+    // updates its factor on the next solve() instead of refactoring
+    template<typename Solver>
+    inline void set_densities(Solver& solver, const std::vector<size_t>& elements, const std::vector<double>& rho){
+        this->change_densities(elements, rho, [&solver](const std::vector<long>& pos, const std::vector<double>& M){
+            solver.modify(pos, M);
+        });
+    }
+    // Density of each element, set by generate_K()
+    inline const std::vector<double>& get_densities() const{
+        return this->rho;
+    }
+    // Load vector of the current boundary conditions, including the
+    // Dirichlet terms. Set up by generate_K().
+    inline const std::vector<double>& get_load() const{
+        return this->load;
+    }
+    // Load vector of a single Neumann boundary, with the same arguments as
+    // apply_Neumann(). Only valid after generate_K().
+    std::vector<double> neumann_load(double d, Point begin, Point end) const;
+
+    // Deflation vectors for DeflatedPCG (a group index per DOF), from the
+    // densities of generate_K(): one group per connected region of
+    // elements denser than the geometric mean of the lightest and
+    // heaviest ones, each split further along a bx x by grid of
+    // subdomains. DOFs only touching lighter elements are in no group.
+    std::vector<long> deflation_groups(size_t bx = 1, size_t by = 1) const;
+
+    // DOF of each grid node (x + y*(W+1)), negative for Dirichlet nodes
+    std::vector<long> grid_dof_map() const;
 
     std::vector<double> get_result();
+    // Result of one column of a batched solve
+    std::vector<double> get_result(const Eigen::MatrixXd& psi, size_t load_case) const;
+    // Result of any vector of DOFs, e.g. an iterate
+    std::vector<double> get_result(const double* psi) const;
 
     dplib::SparseMatrix K;
     inline size_t matrix_size(){
@@ -75,10 +146,20 @@ class RectangularMesh{
     std::vector<double> dirichlet;
     std::vector<NeumannBoundary> neumann;
     std::vector<double> psi;
+    std::vector<double> rho;
     std::vector<size_t> old_position_mapping;
     dplib::EigenCholesky solver;
+    dplib::StencilOperator stencil;
 
     double ring(const Point& p, double min);
+    void generate_load();
+    NeumannBoundary neumann_boundary(double d, Point begin, Point end) const;
+    void add_neumann(const NeumannBoundary& n, std::vector<double>& load) const;
+    std::vector<double> element_matrix() const;
+    void element_dofs(size_t e, std::vector<long>& u_pos) const;
+    // Dirichlet terms of an element matrix M on u_pos, into the load vector
+    void add_dirichlet(const std::vector<long>& u_pos, const std::vector<double>& M);
+    void change_densities(const std::vector<size_t>& elements, const std::vector<double>& rho, const std::function<void(const std::vector<long>&, const std::vector<double>&)>& changed);
 };
 
 //Mesh cantilever(size_t W, size_t H, double element_size, double fx, double fy, double f_len);
@@ -0,0 +1,91 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DPLIB_MULTI_SHIFT_CG_HPP
+#define DPLIB_MULTI_SHIFT_CG_HPP
+
+#include <Eigen/Core>
+#include <cstddef>
+#include <vector>
+#include "lib/linear_operator.hpp"
+#include "lib/sparse_matrix.hpp"
+
+namespace dplib{
+
+// Solves (K + sigma*I)*x = b for several shifts sigma at once.
+//
+// The Krylov spaces of K + sigma*I for b do not depend on sigma, so one CG
+// iteration on the smallest shift (the slowest to converge) gives the
+// iterates of every other shift through a scalar recurrence (Jegerlehner's
+// multi-shift CG). Each iteration costs one product with K for all the
+// shifts, plus two vector updates per shift still running. Shifts that
+// converge are dropped from the updates.
+//
+// There is no preconditioner: only a multiple of the identity keeps the
+// shifted Krylov spaces equal.
+class MultiShiftCG{
+    public:
+    typedef Eigen::SparseMatrix<double, Eigen::ColMajor, std::ptrdiff_t> Mat;
+
+    // Not copied if all entries of M are in its compressed pattern, in
+    // which case M must outlive the solve
+    void set_K(SparseMatrix& M, size_t L);
+    // Matrix-free operator, must outlive the solver
+    void set_K(const LinearOperator& A);
+    // K + sigma*I must be positive definite for all of them
+    void set_shifts(const std::vector<double>& shifts);
+    // Of the product with an assembled K
+    inline void set_storage(SpMV::Storage storage){
+        this->sparse_op.set_storage(storage);
+    }
+    // Relative residual, for each shift
+    inline void set_tolerance(double tol){
+        this->tol = tol;
+    }
+    inline void set_max_iterations(size_t it){
+        this->max_it = it;
+    }
+    // Column s of X is the solution for shift s
+    void solve(Eigen::MatrixXd& X, const Eigen::VectorXd& b);
+    void solve(std::vector<std::vector<double>>& x, const std::vector<double>& b);
+
+    // Of the smallest shift, the others converge in fewer
+    inline size_t iterations() const{
+        return this->it;
+    }
+    // Relative residual estimate of each shift (from the recurrences)
+    inline const std::vector<double>& error() const{
+        return this->errors;
+    }
+
+    private:
+    Mat K;
+    SparseOperator sparse_op;
+    const LinearOperator* A = nullptr;
+    std::vector<double> shifts;
+    double tol = 1e-10;
+    size_t max_it = 0;
+    size_t it = 0;
+    std::vector<double> errors;
+};
+
+}
+
+#endif
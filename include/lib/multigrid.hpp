@@ -0,0 +1,166 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DPLIB_MULTIGRID_HPP
+#define DPLIB_MULTIGRID_HPP
+
+#include <vector>
+#include "lib/eigen.hpp"
+#include "lib/preconditioner.hpp"
+
+namespace dplib{
+
+// V-cycle machinery shared by the multigrid preconditioners. Derived
+// classes fill in the prolongation operators and call setup_hierarchy().
+// Pre-smoothing is the transpose of post-smoothing, so the cycle is
+// symmetric and can be used with CG.
+class Multigrid : public Preconditioner{
+    public:
+    typedef Eigen::SparseMatrix<double, Eigen::ColMajor, std::ptrdiff_t> Mat;
+
+    enum class Smoother{
+        GAUSS_SEIDEL,
+        CHEBYSHEV
+    };
+
+    void apply(const Eigen::VectorXd& r, Eigen::VectorXd& z) const override;
+
+    // Sweeps per smoothing step (polynomial degree for Chebyshev)
+    inline void set_smoother(Smoother smoother, size_t sweeps){
+        this->smoother = smoother;
+        this->sweeps = sweeps;
+    }
+    // Levels with at most this many DOFs are solved directly
+    inline void set_max_coarse_size(size_t size){
+        this->max_coarse_size = size;
+    }
+    inline size_t number_of_levels() const{
+        return this->levels.size();
+    }
+    void print_hierarchy() const;
+
+    protected:
+    struct Level{
+        // Full symmetric matrix
+        Mat A;
+        // Prolongation from the next coarser level
+        Mat P;
+        Eigen::VectorXd inv_diag;
+        // Largest eigenvalue of D^-1*A, used by Chebyshev
+        double lambda_max = 0;
+    };
+
+    std::vector<Level> levels;
+    Smoother smoother = Smoother::GAUSS_SEIDEL;
+    size_t sweeps = 1;
+    size_t max_coarse_size = 2000;
+
+    // Computes the Galerkin operators P^T*A*P down the hierarchy, starting
+    // from levels[0].A, then calls finish_hierarchy()
+    void setup_hierarchy();
+    // levels[l+1].A = P^T*A*P
+    void galerkin(size_t l);
+    // Smoother data for every level and factorization of the coarsest one
+    void finish_hierarchy();
+
+    // Largest eigenvalue of D^-1*A, by power iteration
+    static double estimate_lambda_max(const Mat& A, const Eigen::VectorXd& inv_diag);
+    // y = A*x, for full symmetric A
+    static void product(const Mat& A, const Eigen::VectorXd& x, Eigen::VectorXd& y);
+
+    private:
+    EigenCholesky coarse;
+
+    void cycle(size_t l, const Eigen::VectorXd& b, Eigen::VectorXd& x) const;
+    void gauss_seidel(const Level& L, const Eigen::VectorXd& b, Eigen::VectorXd& x, bool forward) const;
+    void chebyshev(const Level& L, const Eigen::VectorXd& b, Eigen::VectorXd& x) const;
+};
+
+// Multigrid for the structured W x H Q4 grid of RectangularMesh, using
+// bilinear interpolation between grids and Galerkin coarse operators, so
+// that jumps in the coefficients are carried down to the coarse levels.
+class GeometricMultigrid : public Multigrid{
+    public:
+    // `dofs` as given by RectangularMesh::grid_dof_map()
+    GeometricMultigrid(size_t W, size_t H, std::vector<long> dofs);
+
+    // Requires an assembled operator
+    void compute(const LinearOperator& A) override;
+
+    private:
+    struct Grid{
+        size_t W, H;
+        std::vector<long> dofs;
+    };
+    std::vector<Grid> grids;
+
+    void generate_grids();
+};
+
+// Smoothed aggregation multigrid, built from the assembled matrix alone.
+//
+// Connections are strong if |a_ij| >= theta*sqrt(a_ii*a_jj). Since the
+// measure is relative to the diagonals, a 1e-9 region stays strongly
+// connected internally while its coupling to the stiff material is weak,
+// so aggregates do not cross coefficient jumps. The tentative piecewise
+// constant prolongation is smoothed with one damped Jacobi step on the
+// filtered matrix (weak connections lumped into the diagonal).
+//
+// Aggregation is greedy, run in parallel on contiguous blocks of DOFs
+// with a serial pass over the DOFs coupled across blocks, so the
+// aggregates depend slightly on the number of threads.
+//
+// The aggregates are kept between calls to compute() as long as the
+// matrix keeps the same sparsity pattern, so only the prolongation
+// smoothing and the Galerkin products are redone. reset() forces a full
+// setup.
+class AlgebraicMultigrid : public Multigrid{
+    public:
+    void compute(const LinearOperator& A) override;
+
+    inline void set_strength_threshold(double theta){
+        this->theta = theta;
+    }
+    inline void set_max_levels(size_t max_levels){
+        this->max_levels = max_levels;
+    }
+    inline void reset(){
+        this->aggregates.clear();
+    }
+
+    private:
+    double theta = 0.08;
+    size_t max_levels = 10;
+    // Pattern of the matrix the aggregates were built for
+    std::vector<std::ptrdiff_t> pattern_outer;
+    std::vector<std::ptrdiff_t> pattern_inner;
+    // Aggregate of each DOF, for each level but the coarsest
+    std::vector<std::vector<long>> aggregates;
+
+    // Flags for each stored entry of A
+    std::vector<char> strength(const Mat& A) const;
+    // DOFs without strong connections are left out (-1)
+    std::vector<long> aggregate(const Mat& A, const std::vector<char>& strong, long& number_of_aggregates) const;
+    Mat smoothed_prolongation(const Mat& A, const std::vector<char>& strong, const std::vector<long>& agg, long number_of_aggregates) const;
+};
+
+}
+
+#endif
@@ -0,0 +1,172 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DPLIB_PRECONDITIONER_HPP
+#define DPLIB_PRECONDITIONER_HPP
+
+#include <Eigen/Core>
+#include <Eigen/IterativeLinearSolvers>
+#include <Eigen/SparseCholesky>
+#include <memory>
+#include <vector>
+#include "lib/linear_operator.hpp"
+
+namespace dplib{
+
+class Preconditioner{
+    public:
+    virtual ~Preconditioner() = default;
+
+    // Called by the solver before iterating. Preconditioners which need more
+    // than the operator are set up beforehand and may ignore it.
+    virtual void compute(const LinearOperator& A){
+        (void)A;
+    }
+    // z = M^-1 * r
+    virtual void apply(const Eigen::VectorXd& r, Eigen::VectorXd& z) const = 0;
+};
+
+// No preconditioning, e.g. so that the CG coefficients give the spectrum
+// of K itself
+class IdentityPreconditioner : public Preconditioner{
+    public:
+    inline void apply(const Eigen::VectorXd& r, Eigen::VectorXd& z) const override{
+        z = r;
+    }
+};
+
+class JacobiPreconditioner : public Preconditioner{
+    public:
+    void compute(const LinearOperator& A) override;
+    void apply(const Eigen::VectorXd& r, Eigen::VectorXd& z) const override;
+
+    private:
+    Eigen::VectorXd inv_diag;
+};
+
+// Zero fill-in incomplete Cholesky, in the numbering of K. The matrix is
+// scaled to unit diagonal first. If a pivot breaks down (as may happen
+// with K_MIN = 0), the factorization is restarted on the matrix shifted by
+// alpha*I, doubling alpha each time.
+class IC0Preconditioner : public Preconditioner{
+    public:
+    typedef LinearOperator::Mat Mat;
+
+    // Requires an assembled operator
+    void compute(const LinearOperator& A) override;
+    void apply(const Eigen::VectorXd& r, Eigen::VectorXd& z) const override;
+
+    // Shift used in the last factorization
+    inline double get_shift() const{
+        return this->alpha;
+    }
+
+    private:
+    Mat L;
+    Eigen::VectorXd scale;
+    double alpha = 0;
+};
+
+// Threshold incomplete Cholesky (Eigen's implementation, after Lin and
+// More), keeping as many entries per column as K has, with AMD ordering.
+// Also shifts the diagonal on breakdown, starting from the initial shift.
+class ICTPreconditioner : public Preconditioner{
+    public:
+    // Requires an assembled operator
+    void compute(const LinearOperator& A) override;
+    void apply(const Eigen::VectorXd& r, Eigen::VectorXd& z) const override;
+
+    // Relative to the scaled diagonal
+    inline void set_initial_shift(double shift){
+        this->ict.setInitialShift(shift);
+    }
+
+    private:
+    Eigen::SparseMatrix<double, Eigen::ColMajor, int> K;
+    Eigen::IncompleteCholesky<double, Eigen::Lower, Eigen::AMDOrdering<int>> ict;
+};
+
+// Splits the DOFs into contiguous blocks, each factored exactly (and
+// independently, one per thread). Neighboring DOFs are numbered closely
+// by RCM, so the blocks are strips of the mesh.
+class BlockJacobiPreconditioner : public Preconditioner{
+    public:
+    typedef LinearOperator::Mat Mat;
+
+    // 0 for one block per OpenMP thread
+    inline void set_blocks(size_t blocks){
+        this->blocks = blocks;
+    }
+    // Requires an assembled operator
+    void compute(const LinearOperator& A) override;
+    void apply(const Eigen::VectorXd& r, Eigen::VectorXd& z) const override;
+
+    private:
+    typedef Eigen::SimplicialLLT<Mat, Eigen::Lower, Eigen::AMDOrdering<std::ptrdiff_t>> Factor;
+
+    size_t blocks = 0;
+    // Pattern of the matrix the blocks were analyzed for
+    std::vector<std::ptrdiff_t> pattern_outer;
+    std::vector<std::ptrdiff_t> pattern_inner;
+    std::vector<std::ptrdiff_t> begin;
+    std::vector<std::unique_ptr<Factor>> factors;
+};
+
+// Exposes a Preconditioner to Eigen's iterative solvers
+class PreconditionerWrapper{
+    public:
+    PreconditionerWrapper() = default;
+
+    template<typename MatType>
+    explicit PreconditionerWrapper(const MatType&){}
+
+    template<typename MatType>
+    inline PreconditionerWrapper& analyzePattern(const MatType&){
+        return *this;
+    }
+    template<typename MatType>
+    inline PreconditionerWrapper& factorize(const MatType&){
+        return *this;
+    }
+    template<typename MatType>
+    inline PreconditionerWrapper& compute(const MatType&){
+        return *this;
+    }
+
+    inline Eigen::VectorXd solve(const Eigen::VectorXd& r) const{
+        Eigen::VectorXd z(r.size());
+        this->P->apply(r, z);
+        return z;
+    }
+    inline Eigen::ComputationInfo info() const{
+        return Eigen::Success;
+    }
+
+    inline void set(const Preconditioner* P){
+        this->P = P;
+    }
+
+    private:
+    const Preconditioner* P = nullptr;
+};
+
+}
+
+#endif
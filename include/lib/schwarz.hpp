@@ -0,0 +1,119 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef DPLIB_SCHWARZ_HPP
+#define DPLIB_SCHWARZ_HPP
+
+#include <Eigen/Core>
+#include <Eigen/Cholesky>
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "lib/eigen.hpp"
+#include "lib/preconditioner.hpp"
+
+namespace dplib{
+
+// Two-level overlapping additive Schwarz preconditioner on the structured
+// W x H grid of RectangularMesh.
+//
+// The elements are split into a px x py grid of boxes (strips if one of
+// them is 1), each grown by `overlap` layers of elements. The principal
+// submatrix of K on the DOFs of each grown box (zero Dirichlet conditions
+// on its artificial boundary) is factored by its own EigenCholesky, the
+// subdomains being factored and solved concurrently, one per thread. The
+// coarse space has one constant per non-overlapping box (Nicolaides), so
+// that the correction reaches subdomains not touching the Dirichlet
+// boundary, and its Galerkin operator Z^T*K*Z is factored densely:
+//
+//     z = sum_i R_i^T*K_i^{-1}*R_i*r + Z*(Z^T*K*Z)^{-1}*Z^T*r
+//
+// Symmetric, so it can be used with EigenPCG. Requires an assembled K.
+class SchwarzPreconditioner : public Preconditioner{
+    public:
+    // `dofs` as given by RectangularMesh::grid_dof_map()
+    SchwarzPreconditioner(size_t W, size_t H, std::vector<long> dofs);
+
+    // Boxes along x and y
+    inline void set_subdomains(size_t px, size_t py){
+        this->px = std::max<size_t>(std::min(px, this->W), 1);
+        this->py = std::max<size_t>(std::min(py, this->H), 1);
+        this->subdomains.clear();
+    }
+    // Layers of elements added around each box
+    inline void set_overlap(size_t overlap){
+        this->overlap = overlap;
+        this->subdomains.clear();
+    }
+    inline void set_coarse_space(bool enable){
+        this->coarse = enable;
+    }
+    // Replaces the box constants with one coarse vector per group (a
+    // group index per DOF, negative for none), e.g. from
+    // RectangularMesh::deflation_groups(px, py), which keeps regions
+    // separated by a low density from sharing a constant
+    inline void set_coarse_groups(std::vector<long> groups){
+        this->groups = std::move(groups);
+        this->subdomains.clear();
+    }
+    void compute(const LinearOperator& A) override;
+    void apply(const Eigen::VectorXd& r, Eigen::VectorXd& z) const override;
+
+    inline size_t number_of_subdomains() const{
+        return this->subdomains.size();
+    }
+    inline size_t coarse_size() const{
+        return this->m;
+    }
+
+    private:
+    struct Subdomain{
+        // Global DOFs, ascending, so that the lower triangle of K stays
+        // the lower triangle of the local matrix
+        std::vector<std::ptrdiff_t> dofs;
+        std::unique_ptr<EigenCholesky> factor;
+        mutable Eigen::VectorXd r, z;
+    };
+
+    const size_t W, H;
+    const std::vector<long> dofs;
+    size_t px = 2, py = 2;
+    size_t overlap = 1;
+    bool coarse = true;
+    std::vector<Subdomain> subdomains;
+    // User given coarse groups, if any
+    std::vector<long> groups;
+    // Coarse vector of each DOF
+    std::vector<long> group;
+    size_t m = 0;
+    Eigen::LDLT<Eigen::MatrixXd> E;
+
+    void setup(std::ptrdiff_t n);
+    // First element of each of the `parts` boxes along a side of `size`
+    // elements (and `size` at the end)
+    static std::vector<size_t> split(size_t size, size_t parts);
+};
+
+}
+
+#endif
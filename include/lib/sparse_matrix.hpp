@@ -23,6 +23,7 @@
 
 #include <Eigen/SparseCore>
 #include <Eigen/src/SparseCore/SparseUtil.h>
+#include <algorithm>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -38,6 +39,8 @@ template <class T> inline void hash_combine(size_t &seed, T const &v) {
 
 class SparseMatrix{
     public:
+    typedef Eigen::Map<const Eigen::SparseMatrix<double, Eigen::ColMajor, std::ptrdiff_t>> EigenMap;
+
     class Point{
         public:
         Point(size_t i, size_t j): i(i), j(j){}
@@ -64,13 +67,63 @@ class SparseMatrix{
         }
     };
 
+    // Symbolic phase: builds the compressed-column pattern of the lower
+    // triangle from the element connectivity, plus the element-to-slot map
+    // used by insert_element_matrix(). Entries outside of the pattern are
+    // still accepted by set()/add(), but fall back to the hash map.
+    void generate_pattern(const std::vector<size_t>& element_nodes, const std::vector<long>& node_vector_mapping, const size_t nodes_per_element, const size_t dof_per_node, const size_t L);
+    // Numeric phase: scatters the lower triangle of an element matrix
+    // directly into the value array
+    inline void insert_element_matrix(const size_t e, const std::vector<double>& M){
+        const long* slots = this->element_slots.data() + e*this->slots_per_element;
+        const size_t W = this->element_size;
+        size_t k = 0;
+        for(size_t i = 0; i < W; ++i){
+            for(size_t j = 0; j <= i; ++j, ++k){
+                if(slots[k] > -1){
+                    this->values[slots[k]] += M[i*W + j];
+                }
+            }
+        }
+    }
+    inline bool has_pattern() const{
+        return !this->outer.empty();
+    }
+    inline size_t matrix_size() const{
+        return this->has_pattern() ? this->outer.size() - 1 : this->L;
+    }
+    // Every entry is in the compressed pattern, so eigen_map() sees the
+    // whole matrix
+    inline bool is_compressed() const{
+        return this->has_pattern() && this->data.empty();
+    }
+    // Wraps the compressed pattern without copying it. Stays valid (and
+    // sees later changes to the values) until the pattern is regenerated
+    // or cleared, which changes pattern_revision().
+    inline EigenMap eigen_map() const{
+        const std::ptrdiff_t N = this->outer.size() - 1;
+        return EigenMap(N, N, this->values.size(), this->outer.data(), this->inner.data(), this->values.data());
+    }
+    inline size_t pattern_revision() const{
+        return this->revision;
+    }
+
     void set(size_t i, size_t j, double val);
     void add(size_t i, size_t j, double val);
+    // K += sigma*I, in place. Diagonal entries are the first of their
+    // column in the compressed pattern, so there is no lookup per row.
+    void shift_diagonal(double sigma);
     double get(size_t i, size_t j) const;
     void insert_matrix(std::vector<double> M, std::vector<long> pos);
     void merge(SparseMatrix& M);
-    std::vector<double> multiply(std::vector<double> vec) const;
+    // Product with the symmetric matrix: the compressed pattern is its
+    // lower triangle, and a hash map entry (i, j) also stands for (j, i),
+    // as in to_symmetric_band()
+    std::vector<double> multiply(const std::vector<double>& vec) const;
     std::vector<double> to_general_band(size_t diag_size, size_t& ku, size_t& kl) const;
+    // LAPACK lower symmetric band storage (column-major, leading dimension
+    // kd+1), as used by dpbtrf. Computes kd itself.
+    std::vector<double> to_symmetric_band(size_t diag_size, size_t& kd) const;
     std::vector<size_t> affected_ids(const std::vector<size_t>& ids) const;
     void calculate_dimensions();
     inline void get_band_dimensions(size_t& L, size_t& W) const{
@@ -88,7 +141,7 @@ class SparseMatrix{
         W = this->ku + this->kl + 1;
     }
     inline size_t nnz() const{
-        return this->data.size();
+        return this->values.size() + this->data.size();
     }
     std::vector<std::ptrdiff_t> eigen_resize_vector();
     // One-indexed
@@ -124,17 +177,52 @@ class SparseMatrix{
         }
     }
     void zero();
-    inline void clear(){this->data.clear();}
+    void clear();
 
     template<typename A, int B, typename C>
     inline void to_eigen_sparse(Eigen::SparseMatrix<A, B, C>& K) const{
-        typedef Eigen::Triplet<double, std::ptrdiff_t> T;
-        std::vector<T> t;
-        t.reserve(this->data.size());
-        for(const auto& v:this->data){
-            t.emplace_back(v.first.i, v.first.j, v.second);
+        if(B == Eigen::ColMajor && this->is_compressed()){
+            // Same layout, so just copy the arrays
+            const size_t N = this->outer.size() - 1;
+            K.resize(N, N);
+            K.resizeNonZeros(this->values.size());
+            std::copy(this->outer.begin(), this->outer.end(), K.outerIndexPtr());
+            std::copy(this->inner.begin(), this->inner.end(), K.innerIndexPtr());
+            std::copy(this->values.begin(), this->values.end(), K.valuePtr());
+            return;
         }
-        K.setFromTriplets(t.begin(), t.end());
+        // Entries are unique, so they can be inserted directly instead of
+        // going through a copy as triplets
+        Eigen::Matrix<C, Eigen::Dynamic, 1> sizes = Eigen::Matrix<C, Eigen::Dynamic, 1>::Zero(K.outerSize());
+        this->for_each([&sizes](size_t i, size_t j, double){
+            ++sizes[(B == Eigen::ColMajor) ? j : i];
+        });
+        K.setZero();
+        K.reserve(sizes);
+        this->for_each([&K](size_t i, size_t j, double v){
+            K.insert(i, j) = v;
+        });
+        K.makeCompressed();
+    }
+    // Refills the values of a matrix previously generated by
+    // to_eigen_sparse() in place. Returns false if K does not have the
+    // same pattern (compared entry by entry, so a regenerated pattern or
+    // another matrix of the same size is caught), in which case K is left
+    // untouched.
+    template<typename A, int B, typename C>
+    inline bool update_eigen_values(Eigen::SparseMatrix<A, B, C>& K) const{
+        if(B != Eigen::ColMajor || !this->is_compressed() || !K.isCompressed()){
+            return false;
+        }
+        if(static_cast<size_t>(K.outerSize()) + 1 != this->outer.size() || static_cast<size_t>(K.nonZeros()) != this->values.size()){
+            return false;
+        }
+        if(!std::equal(this->outer.begin(), this->outer.end(), K.outerIndexPtr()) ||
+           !std::equal(this->inner.begin(), this->inner.end(), K.innerIndexPtr())){
+            return false;
+        }
+        std::copy(this->values.begin(), this->values.end(), K.valuePtr());
+        return true;
     }
 
     private:
@@ -143,7 +231,31 @@ class SparseMatrix{
     size_t kl = 0;
     size_t L = 0;
 
+    // Compressed-column pattern (lower triangle)
+    std::vector<std::ptrdiff_t> outer;
+    std::vector<std::ptrdiff_t> inner;
+    std::vector<double> values;
+    std::vector<long> element_slots;
+    size_t element_size = 0;
+    size_t slots_per_element = 0;
+    size_t revision = 0;
+
     Point point_to_general_band(Point p) const;
+    long find_slot(size_t i, size_t j) const;
+
+    // Visits every stored entry, compressed pattern first
+    template<typename F>
+    inline void for_each(F f) const{
+        const size_t N = this->has_pattern() ? this->outer.size() - 1 : 0;
+        for(size_t j = 0; j < N; ++j){
+            for(auto p = this->outer[j]; p < this->outer[j+1]; ++p){
+                f(this->inner[p], j, this->values[p]);
+            }
+        }
+        for(const auto& v:this->data){
+            f(v.first.i, v.first.j, v.second);
+        }
+    }
 };
 
 }
@@ -0,0 +1,105 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DPLIB_SPECTRAL_HPP
+#define DPLIB_SPECTRAL_HPP
+
+#include <Eigen/Core>
+#include <unsupported/Eigen/FFT>
+#include <complex>
+#include <cstddef>
+#include <vector>
+#include "lib/preconditioner.hpp"
+
+namespace dplib{
+
+// Inverse of the constant coefficient Q4 diffusion operator on the
+// structured W x H grid of RectangularMesh (square elements), applied
+// with fast sine/cosine transforms in O(n log n).
+//
+// Along each axis, the 1D stiffness and mass matrices of linear elements
+// share the sine (Dirichlet end) or cosine (free end) eigenvectors, so
+// their tensor products, and with them the 2D operator, are diagonal in
+// the product basis. The transforms are done through Eigen's FFT module
+// (kissfft, no external library), with one FFT of length about twice
+// the number of nodes per line.
+//
+// The sides are taken as Dirichlet if all of their nodes are, and as
+// natural boundaries otherwise. By default the operator uses the largest
+// coefficient found on the diagonal of K, which also works well across
+// the 1e-9 ring. With coefficient scaling, it is scaled symmetrically by
+// sqrt(diag(K)/diag(T)) instead, so that each region sees its own
+// coefficient. DOFs whose rows of an assembled K are (almost) only a
+// diagonal, like the ring with K_MIN = 0, get Jacobi instead.
+class SpectralPreconditioner : public Preconditioner{
+    public:
+    // `dofs` as given by RectangularMesh::grid_dof_map()
+    SpectralPreconditioner(size_t W, size_t H, std::vector<long> dofs);
+
+    inline void set_coefficient_scaling(bool enable){
+        this->scaling = enable;
+    }
+    void compute(const LinearOperator& A) override;
+    void apply(const Eigen::VectorXd& r, Eigen::VectorXd& z) const override;
+
+    private:
+    typedef std::vector<std::complex<double>> ComplexVector;
+
+    // Basis along one axis: node j (counted from the first grid node)
+    // has the value trig(j*pi*(k + shift)/P) in mode k
+    struct Axis{
+        // Grid nodes [first, first + n) are unknowns
+        size_t first = 0;
+        size_t n = 0;
+        bool cosine = false;
+        double shift = 0;
+        size_t P = 0;
+        // Mode norms in the inner product weighted by `weight`
+        std::vector<double> norm;
+        // Eigenvalues of the 1D stiffness and mass matrices (unit
+        // element size, which cancels out in 2D)
+        std::vector<double> stiffness, mass;
+        // 1/2 on free ends, where the rows are half of the interior ones
+        std::vector<double> weight;
+        // e^{-i*pi*j*shift/P}
+        ComplexVector twiddle;
+
+        void setup(size_t nodes, bool dirichlet_begin, bool dirichlet_end);
+        // y_k = sum_j x_j*trig(j*theta_k)
+        void analysis(const double* x, double* y, Eigen::FFT<double>& fft, ComplexVector& in, ComplexVector& out) const;
+        // x_j = sum_k y_k*trig(j*theta_k)
+        void synthesis(const double* y, double* x, Eigen::FFT<double>& fft, ComplexVector& in, ComplexVector& out) const;
+    };
+
+    const size_t W, H;
+    const std::vector<long> dofs;
+    bool scaling = false;
+    Axis X, Y;
+    // Inverse eigenvalues divided by the mode norms, row-major (Y.n x X.n)
+    std::vector<double> inv_lambda;
+    Eigen::VectorXd inv_scale;
+    // DOFs outside of the transformed rectangle get Jacobi
+    Eigen::VectorXd inv_diag;
+    mutable std::vector<Eigen::FFT<double>> fft;
+};
+
+}
+
+#endif
@@ -0,0 +1,86 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef DPLIB_SPMV_HPP
+#define DPLIB_SPMV_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace dplib{
+
+// Sparse matrix-vector product y = A*x for a symmetric A given by its lower
+// triangle in compressed-column form (the layout of SparseMatrix and of the
+// solvers' K). Rows are split among OpenMP threads with about the same
+// number of nonzeros each, and the dot products gather x with AVX-512 or
+// AVX2 when the build targets them.
+//
+// SYMMETRIC works on the lower triangle itself: column j of L is row j of
+// L^T, so it gives the dot product for y_j and is scattered into the rows
+// below it. Scatters past the rows of a thread go to a private buffer,
+// added to y at the end.
+// GENERAL expands A into full compressed-row storage (twice the memory),
+// so each row is an independent dot product.
+class SpMV{
+    public:
+    enum class Storage{
+        SYMMETRIC,
+        GENERAL
+    };
+
+    void set_storage(Storage storage);
+    // SYMMETRIC references the arrays instead of copying them, so they must
+    // outlive the engine. GENERAL copies them, so call again after changing
+    // the values.
+    void set_lower(size_t n, const std::ptrdiff_t* outer, const std::ptrdiff_t* inner, const double* values);
+    // Not thread-safe, as the scatter buffers are shared between calls
+    void multiply(const double* x, double* y) const;
+
+    inline size_t size() const{
+        return this->n;
+    }
+
+    private:
+    Storage storage = Storage::SYMMETRIC;
+    size_t n = 0;
+    const std::ptrdiff_t* outer = nullptr;
+    const std::ptrdiff_t* inner = nullptr;
+    const double* values = nullptr;
+
+    // Full matrix, for GENERAL
+    std::vector<std::ptrdiff_t> row_ptr;
+    std::vector<std::ptrdiff_t> col;
+    std::vector<double> val;
+
+    // Thread t owns rows [part[t], part[t+1])
+    std::vector<std::ptrdiff_t> part;
+    // Scatters of thread t into rows [part[t+1], buffer_end[t])
+    std::vector<std::ptrdiff_t> buffer_end;
+    mutable std::vector<std::vector<double>> buffers;
+
+    void build();
+    void multiply_symmetric(const double* x, double* y) const;
+    void multiply_general(const double* x, double* y) const;
+};
+
+}
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DPLIB_STENCIL_OPERATOR_HPP
+#define DPLIB_STENCIL_OPERATOR_HPP
+
+#include <vector>
+#include "lib/linear_operator.hpp"
+
+namespace dplib{
+
+// Matrix-free K for a structured W x H grid of Q4 elements which all share
+// the same element matrix, scaled by a per-element density.
+//
+// Grid nodes are numbered x + y*(W+1) and elements x + y*W. `dofs` maps each
+// grid node to its position in the system, with negative values for
+// Dirichlet nodes, following RectangularMesh's node_vector_mapping (-1 is
+// the first prescribed value, -2 the second, and so on).
+class StencilOperator : public LinearOperator{
+    public:
+    StencilOperator() = default;
+    StencilOperator(size_t W, size_t H, const std::vector<double>& k, std::vector<double> rho, std::vector<long> dofs);
+
+    void apply(const Eigen::VectorXd& x, Eigen::VectorXd& y) const override;
+    Eigen::VectorXd diagonal() const override;
+
+    // load -= K_fd*d, where d are the prescribed values
+    void apply_dirichlet(const std::vector<double>& dirichlet, std::vector<double>& load) const;
+
+    inline const std::vector<double>& get_densities() const{
+        return this->rho;
+    }
+    inline const std::vector<long>& get_dofs() const{
+        return this->dofs;
+    }
+
+    private:
+    size_t W = 0, H = 0;
+    // Element matrix, row-major, in RectangularMesh's node ordering:
+    // (x, y+1), (x+1, y+1), (x+1, y), (x, y)
+    double k[16] = {0};
+    std::vector<double> rho;
+    std::vector<long> dofs;
+
+    void apply_row(size_t y, const Eigen::VectorXd& x, Eigen::VectorXd& out, std::vector<double>& buffer) const;
+};
+
+}
+
+#endif
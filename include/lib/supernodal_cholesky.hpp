@@ -0,0 +1,134 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DPLIB_SUPERNODAL_CHOLESKY_HPP
+#define DPLIB_SUPERNODAL_CHOLESKY_HPP
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+#include <cstddef>
+#include <vector>
+#include "lib/sparse_matrix.hpp"
+
+namespace dplib{
+
+// Multifrontal supernodal Cholesky factorization.
+//
+// The matrix is reordered with AMD (by default) followed by a postorder
+// of the elimination tree, so that each chain of columns with nested
+// structure is contiguous. These chains (supernodes, with some relaxed
+// amalgamation of small ones) are factored as dense blocks with
+// dpotrf/dtrsm, and their Schur complements are formed with dsyrk and
+// added to the parent's front. Supernodes only depend on their
+// children, so independent subtrees are factored in parallel as OpenMP
+// tasks.
+//
+// As with EigenCholesky, the symbolic analysis is kept until reset() is
+// called or the pattern of K changes.
+class SupernodalCholesky{
+    public:
+    typedef Eigen::SparseMatrix<double, Eigen::ColMajor, std::ptrdiff_t> Mat;
+
+    enum class Ordering{
+        AMD,
+        // Keeps the numbering of K (still postordered, which does not
+        // change the fill), e.g. for a nested dissection mesh
+        NATURAL
+    };
+
+    inline void set_ordering(Ordering ordering){
+        if(ordering != this->ordering){
+            this->ordering = ordering;
+            this->first_time = true;
+        }
+    }
+    void set_K(SparseMatrix& M, size_t L);
+    // Lower triangle is used
+    void set_K(const Mat& K);
+    void compute();
+    void solve(std::vector<double>& x, std::vector<double>& b);
+    void solve(Eigen::VectorXd& x, const Eigen::VectorXd& b) const;
+    // One right-hand side per column, with dtrsm/dgemm on each supernode
+    void solve(Eigen::MatrixXd& X, const Eigen::MatrixXd& B) const;
+
+    inline void reset(){
+        this->first_time = true;
+    }
+    inline size_t number_of_supernodes() const{
+        return this->super_begin.size() - 1;
+    }
+    // Including the explicit zeros added by amalgamation
+    inline size_t factor_nonzeros() const{
+        return this->nnz_L;
+    }
+    inline double factor_flops() const{
+        return this->flops;
+    }
+
+    private:
+    bool first_time = true;
+    Ordering ordering = Ordering::AMD;
+    Mat K;
+
+    // perm[i] is the position of DOF i in the factor
+    std::vector<std::ptrdiff_t> perm;
+
+    // Supernode s holds columns [super_begin[s], super_begin[s+1])
+    std::vector<std::ptrdiff_t> super_begin;
+    std::vector<std::ptrdiff_t> super_parent;
+    // Row indices of each supernode, starting with its own columns
+    std::vector<std::ptrdiff_t> rows;
+    std::vector<size_t> rows_begin;
+    // Dense column-major blocks of L, one per supernode
+    std::vector<double> Lx;
+    std::vector<size_t> Lx_begin;
+
+    // Entries of K, in the order they are scattered into Lx
+    std::vector<std::ptrdiff_t> assembly_source;
+    std::vector<size_t> assembly_target;
+    std::vector<size_t> assembly_begin;
+    // Position of the rows of each child's update matrix in its parent's
+    // row list
+    std::vector<std::ptrdiff_t> relative;
+    std::vector<size_t> relative_begin;
+
+    std::vector<std::vector<std::ptrdiff_t>> children;
+
+    size_t nnz_L = 0;
+    double flops = 0;
+
+    void analyze();
+    void factorize();
+    void factorize_supernode(size_t s, std::vector<std::vector<double>>& updates);
+    // In place, on k permuted right-hand sides stored column-major with
+    // leading dimension n
+    void solve_permuted(double* y, std::ptrdiff_t k) const;
+
+    inline std::ptrdiff_t columns(size_t s) const{
+        return this->super_begin[s+1] - this->super_begin[s];
+    }
+    inline std::ptrdiff_t height(size_t s) const{
+        return this->rows_begin[s+1] - this->rows_begin[s];
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,47 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DPLIB_TIMER_HPP
+#define DPLIB_TIMER_HPP
+
+#include <chrono>
+
+namespace dplib{
+
+class Timer{
+    public:
+    Timer():start(std::chrono::steady_clock::now()){}
+
+    inline void reset(){
+        this->start = std::chrono::steady_clock::now();
+    }
+    // In seconds
+    inline double elapsed() const{
+        const auto now = std::chrono::steady_clock::now();
+        return std::chrono::duration<double>(now - this->start).count();
+    }
+
+    private:
+    std::chrono::steady_clock::time_point start;
+};
+
+}
+
+#endif
@@ -28,6 +28,10 @@
 #include <SFML/System/Vector2.hpp>
 #include <SFML/Window.hpp>
 #include <SFML/Graphics.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+#include "lib/image_writer.hpp"
 
 namespace dplib{
 
@@ -37,36 +41,72 @@ class Window{
         GRAYSCALE,
         HSV
     };
-    Window(size_t window_width, size_t window_height, size_t mesh_width, size_t mesh_height, std::string name);
+    enum class Mode{
+        // SFML window, saved as an image when closed
+        INTERACTIVE,
+        // No display connection or event loop: each update with a mesh
+        // draws the field and legend in memory and queues the image to be
+        // written in the background. is_open() is always false.
+        HEADLESS
+    };
+    enum class ImageFormat{
+        PNG,
+        PPM
+    };
+    Window(size_t window_width, size_t window_height, size_t mesh_width, size_t mesh_height, std::string name, Mode mode = Mode::INTERACTIVE);
 
     void update();
     void update(const std::vector<double>& mesh);
     void update(const std::vector<double>& mesh, const double min_x, const double max_x);
     void save_image();
 
+    inline void set_image_format(ImageFormat format){
+        this->format = format;
+    }
     inline bool is_open(){
-        return this->window.isOpen();
+        return this->display && this->display->window.isOpen();
     }
 
     private:
+    // Everything that needs a display (or an OpenGL context, which SFML
+    // creates on the display), only built in interactive mode
+    struct Display{
+        sf::Texture img;
+        sf::Texture legend_img;
+        sf::Sprite sprite;
+        sf::Sprite legend;
+        sf::RenderWindow window;
+        sf::Text text_max;
+        sf::Text text_min;
+        sf::Font font;
+    };
+
     size_t window_width, window_height, W, H, legend_width, legend_height;
-    sf::Texture img;
-    sf::Texture legend_img;
-    sf::Sprite sprite;
-    sf::Sprite legend;
-    sf::RenderWindow window;
     std::vector<sf::Uint8> pixels;
     std::string name;
-    sf::Text text_max;
-    sf::Text text_min;
-    sf::Font font;
     ColorMap colormap = ColorMap::GRAYSCALE;
+    std::unique_ptr<Display> display;
+    ImageFormat format = ImageFormat::PNG;
+    std::vector<sf::Uint8> legend_pixels;
+    std::string label_min, label_max;
+    ImageWriter writer;
 
     void to_grayscale(const std::vector<double>& mesh, const double min_x, const double max_x);
     void to_hsv(const std::vector<double>& mesh, const double min_x, const double max_x);
     void update(const double min_x, const double max_x);
 
     void legend_grayscale();
+    // Draws the sprites and labels at their positions for the current
+    // window size
+    void redraw();
+    inline std::string image_filename() const{
+        return this->name + ((this->format == ImageFormat::PPM) ? ".ppm" : ".png");
+    }
+    // Same layout as the window, drawn into an RGBA canvas at least as
+    // large as the window
+    void render(std::vector<sf::Uint8>& canvas, size_t& width, size_t& height) const;
+    // With a built-in 5x7 font (digits, '.' and '-'), scaled by `scale`
+    static void draw_text(std::vector<sf::Uint8>& canvas, size_t width, size_t x, size_t y, const std::string& s, size_t scale);
 };
 
 }
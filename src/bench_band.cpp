@@ -0,0 +1,87 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include "lib/band_cholesky.hpp"
+#include "lib/mesh.hpp"
+#include "lib/timer.hpp"
+#include "bench_setup.hpp"
+
+// BandCholesky against EigenCholesky for meshes with the same number of
+// elements and increasing aspect ratio
+// Usage: bench_band [elements]
+int main(int argc, char* argv[]){
+    const size_t elements = (argc > 1) ? std::atol(argv[1]) : 160000;
+
+    const double K_MIN = 1e-9;
+
+    std::cout << std::setw(8) << "W" << std::setw(8) << "H" << std::setw(8) << "kd"
+              << std::setw(12) << "eigen [s]" << std::setw(12) << "band [s]" << std::setw(10) << "speedup"
+              << std::setw(12) << "max diff" << std::endl;
+    for(size_t ratio = 1; ratio <= 1024; ratio *= 4){
+        const size_t H = std::max<size_t>(std::round(std::sqrt(elements/static_cast<double>(ratio))), 1);
+        const size_t W = elements/H;
+        // With a single row of elements every node is on the boundary, so
+        // there is nothing to solve
+        if(H < 2){
+            break;
+        }
+
+        std::vector<double> result[2];
+        double times[2];
+        size_t kd = 0;
+        for(size_t s = 0; s < 2; ++s){
+            dplib::RectangularMesh mesh(W, H, 1.0, 1.0);
+
+            bench::dirichlet_all_sides(mesh, W, H);
+
+            mesh.generate_K(K_MIN);
+
+            dplib::Timer timer;
+            if(s == 0){
+                dplib::EigenCholesky solver;
+                mesh.solve(solver);
+            } else {
+                dplib::BandCholesky solver;
+                mesh.solve(solver);
+                kd = solver.bandwidth();
+            }
+            times[s] = timer.elapsed();
+            result[s] = mesh.get_result();
+        }
+        double diff = 0;
+        for(size_t i = 0; i < result[0].size(); ++i){
+            diff = std::max(diff, std::abs(result[0][i] - result[1][i]));
+        }
+
+        std::cout << std::setw(8) << W << std::setw(8) << H << std::setw(8) << kd
+                  << std::setw(12) << std::fixed << std::setprecision(3) << times[0]
+                  << std::setw(12) << times[1]
+                  << std::setw(10) << std::setprecision(2) << times[0]/times[1]
+                  << std::setw(12) << std::scientific << std::setprecision(2) << diff << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+
+    return 0;
+}
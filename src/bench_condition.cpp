@@ -0,0 +1,92 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include "lib/condition.hpp"
+#include "lib/eigen.hpp"
+#include "lib/mesh.hpp"
+#include "lib/preconditioner.hpp"
+#include "bench_setup.hpp"
+
+// Conditioning of K against K_MIN (test1 setup) and against I_MIN with
+// K_MIN = 0 (test3 setup), from Lanczos, from the coefficients of an
+// unpreconditioned CG solve and from Hager's estimate on the Cholesky
+// factor. Lanczos and CG give 2-norm values, Hager the 1-norm condition
+// number and bounds on the eigenvalues.
+// Usage: bench_condition [W] [H] [Lanczos steps]
+int main(int argc, char* argv[]){
+    const size_t W = (argc > 1) ? std::atol(argv[1]) : 100;
+    const size_t H = (argc > 2) ? std::atol(argv[2]) : W;
+    const size_t steps = (argc > 3) ? std::atol(argv[3]) : 300;
+
+    const struct{
+        double K_MIN;
+        double I_MIN;
+    } cases[] = {
+        {1, 0}, {1e-1, 0}, {1e-3, 0}, {1e-6, 0}, {1e-9, 0},
+        {0, 1e-1}, {0, 1e-3}, {0, 1e-6}, {0, 1e-9}
+    };
+
+    std::cout << std::setw(8) << "K_MIN" << std::setw(8) << "I_MIN" << std::setw(10) << "method"
+              << std::setw(14) << "lambda_min" << std::setw(14) << "lambda_max" << std::setw(14) << "condition"
+              << std::setw(8) << "steps" << std::endl;
+    for(const auto& c:cases){
+        dplib::RectangularMesh mesh(W, H, 1.0, 1.0);
+
+        bench::dirichlet_all_sides(mesh, W, H);
+
+        mesh.generate_K(c.K_MIN);
+        if(c.I_MIN > 0){
+            mesh.K.shift_diagonal(c.I_MIN);
+        }
+        const size_t L = mesh.matrix_size();
+
+        const auto lanczos = dplib::lanczos_condition(mesh.K, L, steps);
+
+        dplib::IdentityPreconditioner identity;
+        dplib::EigenPCG pcg;
+        pcg.set_preconditioner(&identity);
+        pcg.set_tolerance(1e-8);
+        pcg.set_condition_estimation(true);
+        mesh.solve(pcg);
+        const auto cg = pcg.get_condition();
+
+        dplib::EigenCholesky cholesky;
+        cholesky.set_condition_estimation(true);
+        cholesky.set_K(mesh.K, L);
+        cholesky.compute();
+        const auto hager = cholesky.get_condition();
+
+        const std::pair<const char*, const dplib::ConditionEstimate*> results[] = {
+            {"Lanczos", &lanczos}, {"CG", &cg}, {"Hager", &hager}
+        };
+        for(const auto& r:results){
+            std::cout << std::setw(8) << std::setprecision(0) << std::scientific << c.K_MIN << std::setw(8) << c.I_MIN
+                      << std::setw(10) << r.first << std::setprecision(3)
+                      << std::setw(14) << r.second->lambda_min << std::setw(14) << r.second->lambda_max
+                      << std::setw(14) << r.second->condition << std::setw(8) << r.second->steps << std::endl;
+        }
+        std::cout.unsetf(std::ios::floatfield);
+    }
+
+    return 0;
+}
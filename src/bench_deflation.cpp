@@ -0,0 +1,99 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include "lib/deflated_pcg.hpp"
+#include "lib/mesh.hpp"
+#include "lib/preconditioner.hpp"
+#include "lib/timer.hpp"
+#include "bench_setup.hpp"
+
+// Iterations and time of plain PCG (EigenPCG) and deflated PCG on the
+// setups of test1 and test2, with the ring region indicators as deflation
+// vectors, alone or split into subdomains
+// Usage: bench_deflation [W] [H] [tolerance] [subdomains per side]
+int main(int argc, char* argv[]){
+    const size_t W = (argc > 1) ? std::atol(argv[1]) : 400;
+    const size_t H = (argc > 2) ? std::atol(argv[2]) : 400;
+    const double tol = (argc > 3) ? std::atof(argv[3]) : 1e-8;
+    const size_t sub = (argc > 4) ? std::atol(argv[4]) : 4;
+
+    const double K_MIN = 1e-9;
+
+    const char* names[] = {"Jacobi", "IC(0)"};
+
+    std::cout << "Relative tolerance " << tol << std::endl;
+    std::cout << std::setw(6) << "test" << std::setw(16) << "preconditioner" << std::setw(12) << "deflation"
+              << std::setw(12) << "iterations" << std::setw(12) << "error" << std::setw(12) << "time [s]" << std::endl;
+    for(int test = 1; test <= 2; ++test){
+        for(int p = 0; p < 2; ++p){
+            for(int d = 0; d < 3; ++d){
+                // New mesh each time, as the last solution would be used
+                // as the initial guess
+                dplib::RectangularMesh mesh(W, H, 1.0, 1.0);
+                if(test == 1){
+                    bench::dirichlet_all_sides(mesh, W, H);
+                } else {
+                    bench::dirichlet_left_neumann_right(mesh, W, H);
+                }
+                mesh.generate_K(K_MIN);
+
+                dplib::IC0Preconditioner ic0;
+                size_t iterations = 0, vectors = 0;
+                double error = 0;
+                // Includes the preconditioner and coarse operator setup
+                dplib::Timer timer;
+                if(d == 0){
+                    dplib::EigenPCG solver;
+                    solver.set_tolerance(tol);
+                    if(p == 1){
+                        solver.set_preconditioner(&ic0);
+                    }
+                    mesh.solve(solver);
+                    iterations = solver.iterations();
+                    error = solver.error();
+                } else {
+                    dplib::DeflatedPCG solver;
+                    solver.set_tolerance(tol);
+                    if(p == 1){
+                        solver.set_preconditioner(&ic0);
+                    }
+                    const size_t s = (d == 1) ? 1 : sub;
+                    solver.set_deflation(mesh.deflation_groups(s, s));
+                    mesh.solve(solver);
+                    iterations = solver.iterations();
+                    error = solver.error();
+                    vectors = solver.deflation_size();
+                }
+                const double t = timer.elapsed();
+
+                std::cout << std::setw(6) << test << std::setw(16) << names[p] << std::setw(12) << vectors
+                          << std::setw(12) << iterations
+                          << std::setw(12) << std::scientific << std::setprecision(2) << error
+                          << std::setw(12) << std::fixed << std::setprecision(3) << t << std::endl;
+                std::cout.unsetf(std::ios::floatfield);
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,125 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include "lib/level_schedule.hpp"
+#include "lib/mesh.hpp"
+#include "lib/timer.hpp"
+#include "bench_setup.hpp"
+
+// Parallelism left by each ordering in the triangular solves (levels of
+// the level-scheduled substitutions), and solve times with and without
+// level scheduling for the AMD orderings used by EigenCholesky
+// Usage: bench_levels [W] [H] [right-hand sides]
+int main(int argc, char* argv[]){
+    const size_t W = (argc > 1) ? std::atol(argv[1]) : 400;
+    const size_t H = (argc > 2) ? std::atol(argv[2]) : W;
+    const long k = (argc > 3) ? std::atol(argv[3]) : 16;
+
+    const double K_MIN = 1e-9;
+    const size_t repeat = 10;
+
+    typedef dplib::RectangularMesh::Ordering MeshOrdering;
+    typedef dplib::LevelSchedule::Mat Mat;
+    const struct{
+        const char* name;
+        MeshOrdering mesh;
+        bool amd;
+    } cases[] = {
+        {"RCM + AMD", MeshOrdering::RCM, true},
+        {"RCM", MeshOrdering::RCM, false},
+        {"ND + AMD", MeshOrdering::NESTED_DISSECTION, true},
+        {"ND", MeshOrdering::NESTED_DISSECTION, false}
+    };
+
+    std::cout << std::setw(12) << "ordering" << std::setw(10) << "levels" << std::setw(14) << "rows/level"
+              << std::setw(12) << "max rows" << std::setw(14) << "serial [s]" << std::setw(14) << "levels [s]"
+              << std::setw(16) << "serial x" << k << " [s]" << std::setw(16) << "levels x" << k << " [s]" << std::endl;
+    for(const auto& c:cases){
+        // Fill is about n*min(W, H) without reordering
+        if(c.mesh == MeshOrdering::RCM && !c.amd && std::min(W, H) > 300){
+            std::cout << std::setw(12) << c.name << "  skipped, factor too large" << std::endl;
+            continue;
+        }
+        dplib::RectangularMesh mesh(W, H, 1.0, 1.0, c.mesh);
+
+        bench::dirichlet_all_sides(mesh, W, H);
+
+        mesh.generate_K(K_MIN);
+        const size_t N = mesh.matrix_size();
+
+        std::vector<std::ptrdiff_t> width;
+        double serial = 0, levels = 0, serial_block = 0, levels_block = 0;
+        if(c.amd){
+            dplib::EigenCholesky solver;
+            solver.set_level_scheduling(true);
+            solver.set_K(mesh.K, N);
+            solver.compute();
+            width = solver.get_schedule().forward_levels();
+
+            const Eigen::VectorXd b = Eigen::VectorXd::Ones(N);
+            const Eigen::MatrixXd B = Eigen::MatrixXd::Ones(N, k);
+            Eigen::VectorXd x;
+            Eigen::MatrixXd X;
+            dplib::Timer timer;
+            for(size_t r = 0; r < repeat; ++r){
+                solver.solve(x, b);
+            }
+            levels = timer.elapsed()/repeat;
+            timer.reset();
+            solver.solve(X, B);
+            levels_block = timer.elapsed();
+
+            solver.set_level_scheduling(false);
+            timer.reset();
+            for(size_t r = 0; r < repeat; ++r){
+                solver.solve(x, b);
+            }
+            serial = timer.elapsed()/repeat;
+            timer.reset();
+            solver.solve(X, B);
+            serial_block = timer.elapsed();
+        } else {
+            Mat K(N, N);
+            mesh.K.to_eigen_sparse(K);
+            Eigen::SimplicialLDLT<Mat, Eigen::Lower, Eigen::NaturalOrdering<std::ptrdiff_t>> ldlt(K);
+            dplib::LevelSchedule schedule;
+            schedule.analyze(ldlt.matrixL().nestedExpression());
+            width = schedule.forward_levels();
+        }
+        const auto total = std::accumulate(width.begin(), width.end(), std::ptrdiff_t(0));
+
+        std::cout << std::setw(12) << c.name << std::setw(10) << width.size()
+                  << std::setw(14) << std::fixed << std::setprecision(1) << static_cast<double>(total)/width.size()
+                  << std::setw(12) << *std::max_element(width.begin(), width.end());
+        if(c.amd){
+            std::cout << std::setprecision(4) << std::setw(14) << serial << std::setw(14) << levels
+                      << std::setw(18) << serial_block << std::setw(18) << levels_block;
+        }
+        std::cout << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+
+    return 0;
+}
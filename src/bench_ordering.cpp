@@ -0,0 +1,86 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include "lib/mesh.hpp"
+#include "lib/supernodal_cholesky.hpp"
+#include "lib/timer.hpp"
+#include "bench_setup.hpp"
+
+// Fill and flop counts of the Cholesky factor for each combination of
+// mesh ordering (RCM or nested dissection) and solver ordering (AMD or
+// natural)
+// Usage: bench_ordering [W] [H]
+int main(int argc, char* argv[]){
+    const size_t W = (argc > 1) ? std::atol(argv[1]) : 1000;
+    const size_t H = (argc > 2) ? std::atol(argv[2]) : W;
+
+    const double K_MIN = 1e-9;
+
+    typedef dplib::RectangularMesh::Ordering MeshOrdering;
+    typedef dplib::SupernodalCholesky::Ordering SolverOrdering;
+    const struct{
+        const char* name;
+        MeshOrdering mesh;
+        SolverOrdering solver;
+    } cases[] = {
+        {"RCM + AMD", MeshOrdering::RCM, SolverOrdering::AMD},
+        {"RCM", MeshOrdering::RCM, SolverOrdering::NATURAL},
+        {"ND + AMD", MeshOrdering::NESTED_DISSECTION, SolverOrdering::AMD},
+        {"ND", MeshOrdering::NESTED_DISSECTION, SolverOrdering::NATURAL}
+    };
+
+    std::cout << std::setw(12) << "ordering" << std::setw(14) << "nnz(L)" << std::setw(14) << "flops"
+              << std::setw(12) << "supernodes" << std::setw(14) << "analyze [s]" << std::setw(14) << "factor [s]" << std::endl;
+    for(const auto& c:cases){
+        // Fill is about n*min(W, H)*2 without reordering, too much memory
+        if(c.mesh == MeshOrdering::RCM && c.solver == SolverOrdering::NATURAL && std::min(W, H) > 500){
+            std::cout << std::setw(12) << c.name << "  skipped, factor too large" << std::endl;
+            continue;
+        }
+        dplib::RectangularMesh mesh(W, H, 1.0, 1.0, c.mesh);
+
+        bench::dirichlet_all_sides(mesh, W, H);
+
+        mesh.generate_K(K_MIN);
+
+        dplib::SupernodalCholesky solver;
+        solver.set_ordering(c.solver);
+        solver.set_K(mesh.K, mesh.matrix_size());
+        dplib::Timer timer;
+        // First call includes the symbolic analysis
+        solver.compute();
+        const double first = timer.elapsed();
+        timer.reset();
+        solver.compute();
+        const double factor = timer.elapsed();
+
+        std::cout << std::setw(12) << c.name << std::setw(14) << solver.factor_nonzeros()
+                  << std::setw(14) << std::scientific << std::setprecision(3) << solver.factor_flops()
+                  << std::setw(12) << solver.number_of_supernodes()
+                  << std::setw(14) << std::fixed << first - factor << std::setw(14) << factor << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+
+    return 0;
+}
@@ -0,0 +1,87 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <omp.h>
+#include "lib/mesh.hpp"
+#include "lib/preconditioner.hpp"
+#include "lib/timer.hpp"
+#include "bench_setup.hpp"
+
+// EigenPCG iterations and time for each preconditioner, on the setups of
+// test1 to test4
+// Usage: bench_preconditioners [W] [H] [tolerance] [blocks]
+int main(int argc, char* argv[]){
+    const size_t W = (argc > 1) ? std::atol(argv[1]) : 400;
+    const size_t H = (argc > 2) ? std::atol(argv[2]) : 400;
+    const double tol = (argc > 3) ? std::atof(argv[3]) : 1e-8;
+    const size_t blocks = (argc > 4) ? std::atol(argv[4]) : omp_get_max_threads();
+
+    const double I_MIN = 1e-9;
+
+    const char* names[] = {"Jacobi", "IC(0)", "ICT", "block Jacobi"};
+
+    std::cout << "Relative tolerance " << tol << ", " << blocks << " Jacobi blocks" << std::endl;
+    std::cout << std::setw(6) << "test" << std::setw(16) << "preconditioner" << std::setw(12) << "iterations"
+              << std::setw(12) << "error" << std::setw(12) << "time [s]" << std::endl;
+    for(int test = 1; test <= 4; ++test){
+        const double K_MIN = (test <= 2) ? 1e-9 : 0;
+        for(int p = 0; p < 4; ++p){
+            dplib::RectangularMesh mesh(W, H, 1.0, 1.0);
+            if(test % 2 == 1){
+                bench::dirichlet_all_sides(mesh, W, H);
+            } else {
+                bench::dirichlet_left_neumann_right(mesh, W, H);
+            }
+            mesh.generate_K(K_MIN);
+            if(test > 2){
+                mesh.K.shift_diagonal(I_MIN);
+            }
+
+            dplib::IC0Preconditioner ic0;
+            dplib::ICTPreconditioner ict;
+            dplib::BlockJacobiPreconditioner block_jacobi;
+            block_jacobi.set_blocks(blocks);
+            dplib::EigenPCG solver;
+            solver.set_tolerance(tol);
+            if(p == 1){
+                solver.set_preconditioner(&ic0);
+            } else if(p == 2){
+                solver.set_preconditioner(&ict);
+            } else if(p == 3){
+                solver.set_preconditioner(&block_jacobi);
+            }
+
+            // Includes the preconditioner setup
+            dplib::Timer timer;
+            mesh.solve(solver);
+            const double t = timer.elapsed();
+
+            std::cout << std::setw(6) << test << std::setw(16) << names[p] << std::setw(12) << solver.iterations()
+                      << std::setw(12) << std::scientific << std::setprecision(2) << solver.error()
+                      << std::setw(12) << std::fixed << std::setprecision(3) << t << std::endl;
+            std::cout.unsetf(std::ios::floatfield);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,63 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <omp.h>
+#include "lib/mesh.hpp"
+#include "lib/timer.hpp"
+
+// Thread scaling of the RectangularMesh constructor, which is dominated by
+// the reverse Cuthill-McKee ordering
+// Usage: bench_rcm [W] [H] [repetitions]
+int main(int argc, char* argv[]){
+    const size_t W = (argc > 1) ? std::atol(argv[1]) : 2000;
+    const size_t H = (argc > 2) ? std::atol(argv[2]) : 2000;
+    const size_t reps = (argc > 3) ? std::atol(argv[3]) : 3;
+
+    const int max_threads = omp_get_max_threads();
+    std::vector<double> times(max_threads + 1, 0);
+    for(int n = 1; n <= max_threads; ++n){
+        omp_set_num_threads(n);
+        double best = 0;
+        for(size_t r = 0; r < reps; ++r){
+            dplib::Timer timer;
+            dplib::RectangularMesh mesh(W, H, 1.0, 1.0);
+            const double t = timer.elapsed();
+            if(r == 0 || t < best){
+                best = t;
+            }
+        }
+        times[n] = best;
+    }
+
+    std::cout << std::endl << "Construction of " << W << "x" << H << " mesh (best of " << reps << ")" << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(12) << "time [s]" << std::setw(10) << "speedup" << std::setw(12) << "efficiency" << std::endl;
+    for(int n = 1; n <= max_threads; ++n){
+        const double speedup = times[1]/times[n];
+        std::cout << std::setw(8) << n
+                  << std::setw(12) << std::fixed << std::setprecision(3) << times[n]
+                  << std::setw(10) << std::setprecision(2) << speedup
+                  << std::setw(12) << std::setprecision(2) << speedup/n << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,81 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "lib/frame_recorder.hpp"
+#include "lib/mesh.hpp"
+#include "lib/timer.hpp"
+#include "bench_setup.hpp"
+
+// Time of an EigenPCG solve on the setup of test2 without recording, and
+// while recording every interval-th iterate with a FrameRecorder (Y4M),
+// with a large and with a small ring buffer: the solve should not slow
+// down, frames being dropped instead when the writer falls behind
+// Usage: bench_recorder [W] [H] [interval] [output.y4m]
+int main(int argc, char* argv[]){
+    const size_t W = (argc > 1) ? std::atol(argv[1]) : 1000;
+    const size_t H = (argc > 2) ? std::atol(argv[2]) : W;
+    const size_t interval = (argc > 3) ? std::atol(argv[3]) : 10;
+    const std::string output = (argc > 4) ? argv[4] : "bench_recorder.y4m";
+
+    const double K_MIN = 1e-9;
+
+    const size_t capacities[] = {0, 256, 2};
+
+    std::cout << std::setw(10) << "buffer" << std::setw(12) << "iterations" << std::setw(12) << "solve [s]"
+              << std::setw(10) << "frames" << std::setw(10) << "dropped" << std::setw(12) << "close [s]" << std::endl;
+    for(const size_t capacity:capacities){
+        dplib::RectangularMesh mesh(W, H, 1.0, 1.0);
+        bench::dirichlet_left_neumann_right(mesh, W, H);
+        mesh.generate_K(K_MIN);
+
+        dplib::FrameRecorder recorder(W, H, output, (capacity > 0) ? capacity : 1);
+        recorder.set_interval(interval);
+        recorder.set_field(mesh.matrix_size(), [&mesh](const double* psi){
+            return mesh.get_result(psi);
+        });
+        dplib::EigenPCG solver;
+        solver.set_tolerance(1e-8);
+        if(capacity > 0){
+            solver.set_iteration_callback([&recorder](size_t, const Eigen::VectorXd& x){
+                recorder.record(x.data());
+            });
+        }
+
+        dplib::Timer timer;
+        mesh.solve(solver);
+        const double solve = timer.elapsed();
+        timer.reset();
+        recorder.close();
+        const double close = timer.elapsed();
+
+        std::cout << std::setw(10) << ((capacity > 0) ? std::to_string(capacity) : "none") << std::setw(12) << solver.iterations()
+                  << std::setw(12) << std::fixed << std::setprecision(3) << solve
+                  << std::setw(10) << recorder.written() << std::setw(10) << recorder.dropped()
+                  << std::setw(12) << close << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+
+    return 0;
+}
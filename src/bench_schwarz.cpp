@@ -0,0 +1,142 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <omp.h>
+#include <vector>
+#include "lib/mesh.hpp"
+#include "lib/schwarz.hpp"
+#include "lib/timer.hpp"
+#include "bench_setup.hpp"
+
+namespace{
+
+enum class Coarse{
+    NONE,
+    BOXES,
+    // RectangularMesh::deflation_groups()
+    GROUPS
+};
+
+const char* coarse_names[] = {"none", "boxes", "groups"};
+
+struct Run{
+    size_t iterations;
+    double setup, solve;
+};
+
+// test2 setup, solved by EigenPCG with a px x py Schwarz preconditioner
+Run run(size_t W, size_t H, size_t px, size_t py, size_t overlap, Coarse coarse, double tol){
+    dplib::RectangularMesh mesh(W, H, 1.0, 1.0);
+    bench::dirichlet_left_neumann_right(mesh, W, H);
+    mesh.generate_K(1e-9);
+
+    dplib::SchwarzPreconditioner schwarz(W, H, mesh.grid_dof_map());
+    schwarz.set_subdomains(px, py);
+    schwarz.set_overlap(overlap);
+    schwarz.set_coarse_space(coarse != Coarse::NONE);
+    if(coarse == Coarse::GROUPS){
+        schwarz.set_coarse_groups(mesh.deflation_groups(px, py));
+    }
+    dplib::EigenPCG solver;
+    solver.set_tolerance(tol);
+    solver.set_preconditioner(&schwarz);
+    solver.set_K(mesh.K, mesh.matrix_size());
+
+    std::vector<double> b(mesh.get_load());
+    std::vector<double> x(b.size(), 0);
+    Run r;
+    dplib::Timer timer;
+    solver.compute();
+    r.setup = timer.elapsed();
+    timer.reset();
+    solver.solve(x, b);
+    r.solve = timer.elapsed();
+    r.iterations = solver.iterations();
+    return r;
+}
+
+}
+
+// Strong scaling of EigenPCG with the two-level overlapping Schwarz
+// preconditioner on the setup of test2 (setup is the concurrent
+// factorization of the subdomains), then its iterations for other
+// subdomain counts and overlaps, with all threads
+// Usage: bench_schwarz [W] [H] [px] [py] [overlap] [tolerance]
+int main(int argc, char* argv[]){
+    const size_t W = (argc > 1) ? std::atol(argv[1]) : 1000;
+    const size_t H = (argc > 2) ? std::atol(argv[2]) : W;
+    const size_t px = (argc > 3) ? std::atol(argv[3]) : 4;
+    const size_t py = (argc > 4) ? std::atol(argv[4]) : px;
+    const size_t overlap = (argc > 5) ? std::atol(argv[5]) : 2;
+    const double tol = (argc > 6) ? std::atof(argv[6]) : 1e-8;
+
+    const int max_threads = omp_get_max_threads();
+    std::vector<Run> runs(max_threads + 1);
+    for(int n = 1; n <= max_threads; ++n){
+        omp_set_num_threads(n);
+        runs[n] = run(W, H, px, py, overlap, Coarse::GROUPS, tol);
+    }
+
+    std::cout << "Strong scaling, " << px << "x" << py << " subdomains, overlap " << overlap
+              << ", relative tolerance " << tol << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(12) << "iterations" << std::setw(12) << "setup [s]"
+              << std::setw(12) << "solve [s]" << std::setw(10) << "speedup" << std::setw(12) << "efficiency" << std::endl;
+    const double serial = runs[1].setup + runs[1].solve;
+    for(int n = 1; n <= max_threads; ++n){
+        const double speedup = serial/(runs[n].setup + runs[n].solve);
+        std::cout << std::setw(8) << n << std::setw(12) << runs[n].iterations
+                  << std::setw(12) << std::fixed << std::setprecision(3) << runs[n].setup
+                  << std::setw(12) << runs[n].solve
+                  << std::setw(10) << std::setprecision(2) << speedup
+                  << std::setw(12) << speedup/n << std::endl;
+    }
+    std::cout.unsetf(std::ios::floatfield);
+
+    const struct{
+        size_t px, py, overlap;
+        Coarse coarse;
+    } cases[] = {
+        {4, 4, 2, Coarse::NONE},
+        {4, 4, 2, Coarse::BOXES},
+        {2, 2, 2, Coarse::GROUPS},
+        {4, 4, 1, Coarse::GROUPS},
+        {4, 4, 2, Coarse::GROUPS},
+        {4, 4, 4, Coarse::GROUPS},
+        {8, 8, 2, Coarse::GROUPS},
+        {8, 1, 2, Coarse::GROUPS}
+    };
+    std::cout << std::endl << "Subdomains and overlap, " << max_threads << " threads" << std::endl;
+    std::cout << std::setw(12) << "subdomains" << std::setw(10) << "overlap" << std::setw(8) << "coarse"
+              << std::setw(12) << "iterations" << std::setw(12) << "setup [s]" << std::setw(12) << "solve [s]" << std::endl;
+    for(const auto& c:cases){
+        const Run r = run(W, H, c.px, c.py, c.overlap, c.coarse, tol);
+        std::cout << std::setw(10) << c.px << "x" << c.py << std::setw(10) << c.overlap << std::setw(8) << coarse_names[static_cast<int>(c.coarse)]
+                  << std::setw(12) << r.iterations
+                  << std::setw(12) << std::fixed << std::setprecision(3) << r.setup
+                  << std::setw(12) << r.solve << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+
+    return 0;
+}
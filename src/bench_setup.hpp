@@ -0,0 +1,50 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef DPLIB_BENCH_SETUP_HPP
+#define DPLIB_BENCH_SETUP_HPP
+
+#include <cstddef>
+#include "lib/mesh.hpp"
+
+// Boundary conditions of the test programs, shared by the benchmarks.
+// Points take doubles, so W and H are converted once here.
+namespace bench{
+
+// test1 and test3: Dirichlet 1 on all four sides
+inline void dirichlet_all_sides(dplib::RectangularMesh& mesh, size_t W, size_t H){
+    const double Wd = W, Hd = H;
+    mesh.apply_Dirichlet(1, {0,0,0}, {Wd+1,0,0});
+    mesh.apply_Dirichlet(1, {Wd+1,0,0}, {Wd+1,Hd+1,0});
+    mesh.apply_Dirichlet(1, {0,0,0}, {0,Hd+1,0});
+    mesh.apply_Dirichlet(1, {0,Hd+1,0}, {Wd+1,Hd+1,0});
+}
+
+// test2 and test4: Dirichlet 0 on the left side, Neumann 1 on the right
+inline void dirichlet_left_neumann_right(dplib::RectangularMesh& mesh, size_t W, size_t H){
+    const double Wd = W, Hd = H;
+    mesh.apply_Dirichlet(0, {0,0,0}, {0,Hd+1,0});
+    mesh.apply_Neumann(1, {Wd+1,0,0}, {Wd+1,Hd+1,0});
+}
+
+}
+
+#endif
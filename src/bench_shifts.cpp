@@ -0,0 +1,93 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include "lib/eigen.hpp"
+#include "lib/mesh.hpp"
+#include "lib/multi_shift_cg.hpp"
+#include "lib/timer.hpp"
+#include "bench_setup.hpp"
+
+// Solves (K + sigma*I)*psi = f for S shifts between 1e-9 and 1e-3, as in
+// test3 (K_MIN = 0), with one multi-shift CG solve and with one Cholesky
+// factorization per shift
+// Usage: bench_shifts [W] [H] [S] [tol]
+int main(int argc, char* argv[]){
+    const size_t W = (argc > 1) ? std::atol(argv[1]) : 400;
+    const size_t H = (argc > 2) ? std::atol(argv[2]) : W;
+    const size_t S = (argc > 3) ? std::atol(argv[3]) : 8;
+    const double tol = (argc > 4) ? std::atof(argv[4]) : 1e-10;
+
+    const double K_MIN = 0;
+
+    std::vector<double> shifts(S);
+    for(size_t s = 0; s < S; ++s){
+        shifts[s] = std::pow(10.0, -9 + (S > 1 ? 6.0*s/(S - 1) : 0.0));
+    }
+
+    dplib::RectangularMesh mesh(W, H, 1.0, 1.0);
+
+    bench::dirichlet_all_sides(mesh, W, H);
+
+    mesh.generate_K(K_MIN);
+    const size_t L = mesh.matrix_size();
+    const Eigen::VectorXd f = Eigen::Map<const Eigen::VectorXd>(mesh.get_load().data(), L);
+
+    dplib::MultiShiftCG cg;
+    cg.set_K(mesh.K, L);
+    cg.set_shifts(shifts);
+    cg.set_tolerance(tol);
+    Eigen::MatrixXd X;
+    dplib::Timer timer;
+    cg.solve(X, f);
+    const double multi = timer.elapsed();
+
+    // One factorization per shift, shifting K in place. The symbolic
+    // analysis is only done once.
+    Eigen::MatrixXd Y(L, S);
+    dplib::EigenCholesky solver;
+    timer.reset();
+    double applied = 0;
+    for(size_t s = 0; s < S; ++s){
+        mesh.K.shift_diagonal(shifts[s] - applied);
+        applied = shifts[s];
+        solver.set_K(mesh.K, L);
+        solver.compute();
+        Eigen::VectorXd y;
+        solver.solve(y, f);
+        Y.col(s) = y;
+    }
+    const double direct = timer.elapsed();
+    mesh.K.shift_diagonal(-applied);
+
+    std::cout << "multi-shift CG: " << cg.iterations() << " iterations, " << multi << " s" << std::endl;
+    std::cout << "Cholesky per shift: " << direct << " s" << std::endl;
+    std::cout << std::setw(12) << "shift" << std::setw(16) << "CG residual" << std::setw(16) << "difference" << std::endl;
+    for(size_t s = 0; s < S; ++s){
+        std::cout << std::scientific << std::setprecision(3) << std::setw(12) << shifts[s]
+                  << std::setw(16) << cg.error()[s]
+                  << std::setw(16) << (X.col(s) - Y.col(s)).norm()/Y.col(s).norm() << std::endl;
+    }
+
+    return 0;
+}
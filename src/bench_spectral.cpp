@@ -0,0 +1,77 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include "lib/mesh.hpp"
+#include "lib/preconditioner.hpp"
+#include "lib/spectral.hpp"
+#include "lib/timer.hpp"
+#include "bench_setup.hpp"
+
+// EigenPCG iterations and time with Jacobi and with the spectral (fast
+// sine/cosine transform) preconditioner, plain and coefficient scaled, on
+// the setups of test2 and test4
+// Usage: bench_spectral [W] [H] [tolerance]
+int main(int argc, char* argv[]){
+    const size_t W = (argc > 1) ? std::atol(argv[1]) : 2000;
+    const size_t H = (argc > 2) ? std::atol(argv[2]) : W;
+    const double tol = (argc > 3) ? std::atof(argv[3]) : 1e-8;
+
+    const double I_MIN = 1e-9;
+
+    const char* names[] = {"Jacobi", "spectral", "scaled spectral"};
+
+    std::cout << "Relative tolerance " << tol << std::endl;
+    std::cout << std::setw(6) << "test" << std::setw(18) << "preconditioner" << std::setw(12) << "iterations"
+              << std::setw(12) << "error" << std::setw(12) << "time [s]" << std::endl;
+    for(int test = 2; test <= 4; test += 2){
+        const double K_MIN = (test == 2) ? 1e-9 : 0;
+        for(int p = 0; p < 3; ++p){
+            dplib::RectangularMesh mesh(W, H, 1.0, 1.0);
+            bench::dirichlet_left_neumann_right(mesh, W, H);
+            mesh.generate_K(K_MIN);
+            if(test == 4){
+                mesh.K.shift_diagonal(I_MIN);
+            }
+
+            dplib::SpectralPreconditioner spectral(W, H, mesh.grid_dof_map());
+            spectral.set_coefficient_scaling(p == 2);
+            dplib::EigenPCG solver;
+            solver.set_tolerance(tol);
+            if(p > 0){
+                solver.set_preconditioner(&spectral);
+            }
+
+            // Includes the preconditioner setup
+            dplib::Timer timer;
+            mesh.solve(solver);
+            const double t = timer.elapsed();
+
+            std::cout << std::setw(6) << test << std::setw(18) << names[p] << std::setw(12) << solver.iterations()
+                      << std::setw(12) << std::scientific << std::setprecision(2) << solver.error()
+                      << std::setw(12) << std::fixed << std::setprecision(3) << t << std::endl;
+            std::cout.unsetf(std::ios::floatfield);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,118 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include "lib/mesh.hpp"
+#include "lib/timer.hpp"
+#include "bench_setup.hpp"
+
+namespace{
+
+// ||K*x - b||/||b||
+double residual(const dplib::SparseMatrix& K, const std::vector<double>& x, const std::vector<double>& b){
+    const auto Kx = K.multiply(x);
+    double r = 0, n = 0;
+    for(size_t i = 0; i < b.size(); ++i){
+        r += (Kx[i] - b[i])*(Kx[i] - b[i]);
+        n += b[i]*b[i];
+    }
+    return std::sqrt(r/n);
+}
+
+}
+
+// Flips the density of N random elements (between 1 and K_MIN) and
+// compares updating the EigenCholesky factor with refactoring it. The
+// flips accumulate from one N to the next.
+// Usage: bench_update [W] [H] [N...]
+int main(int argc, char* argv[]){
+    const size_t W = (argc > 1) ? std::atol(argv[1]) : 1000;
+    const size_t H = (argc > 2) ? std::atol(argv[2]) : W;
+    std::vector<size_t> counts;
+    for(int i = 3; i < argc; ++i){
+        counts.push_back(std::atol(argv[i]));
+    }
+    if(counts.empty()){
+        counts = {1, 10, 100, 1000};
+    }
+
+    const double K_MIN = 1e-9;
+
+    dplib::RectangularMesh mesh(W, H, 1.0, 1.0);
+
+    bench::dirichlet_all_sides(mesh, W, H);
+
+    mesh.generate_K(K_MIN);
+    const size_t L = mesh.matrix_size();
+
+    dplib::EigenCholesky solver;
+    // Always update, to see where refactoring becomes cheaper
+    solver.set_update_limit(std::numeric_limits<size_t>::max());
+    solver.set_K(mesh.K, L);
+    solver.compute();
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<size_t> element(0, W*H - 1);
+    std::vector<double> b, x(L);
+
+    std::cout << std::setw(8) << "N" << std::setw(14) << "update [s]" << std::setw(14) << "factor [s]"
+              << std::setw(16) << "res. update" << std::setw(16) << "res. factor" << std::endl;
+    for(const size_t N:counts){
+        std::vector<size_t> elements(N);
+        for(auto& e:elements){
+            e = element(gen);
+        }
+        std::sort(elements.begin(), elements.end());
+        elements.erase(std::unique(elements.begin(), elements.end()), elements.end());
+        std::vector<double> rho(elements.size());
+        for(size_t i = 0; i < elements.size(); ++i){
+            rho[i] = (mesh.get_densities()[elements[i]] > 0.5) ? K_MIN : 1.0;
+        }
+        mesh.set_densities(solver, elements, rho);
+        b = mesh.get_load();
+
+        solver.set_K(mesh.K, L);
+        dplib::Timer timer;
+        solver.compute();
+        const double update = timer.elapsed();
+        solver.solve(x, b);
+        const double res_update = residual(mesh.K, x, b);
+
+        // No pending changes, so this is a full numeric factorization
+        timer.reset();
+        solver.compute();
+        const double factor = timer.elapsed();
+        solver.solve(x, b);
+        const double res_factor = residual(mesh.K, x, b);
+
+        std::cout << std::setw(8) << N << std::setw(14) << std::fixed << std::setprecision(4) << update
+                  << std::setw(14) << factor << std::setw(16) << std::scientific << std::setprecision(3) << res_update
+                  << std::setw(16) << res_factor << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+
+    return 0;
+}
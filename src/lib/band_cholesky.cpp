@@ -0,0 +1,67 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <lapacke.h>
+#include "lib/band_cholesky.hpp"
+#include "lib/print.hpp"
+
+namespace dplib{
+
+void BandCholesky::set_K(SparseMatrix& M, size_t L){
+    this->n = L;
+    this->band = M.to_symmetric_band(L, this->kd);
+}
+
+void BandCholesky::compute(){
+    const auto info = LAPACKE_dpbtrf(LAPACK_COL_MAJOR, 'L', this->n, this->kd, this->band.data(), this->kd + 1);
+    if(info != 0){
+        print_line("ERROR: banded Cholesky factorization failed (info = " + std::to_string(info) + ").");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void BandCholesky::solve(std::vector<double>& x, std::vector<double>& b){
+    // LAPACK rejects ldb = 0, so a system without unknowns (every node
+    // fixed) is handled here
+    if(this->n == 0){
+        return;
+    }
+    std::copy(b.begin(), b.begin() + this->n, x.begin());
+    const auto info = LAPACKE_dpbtrs(LAPACK_COL_MAJOR, 'L', this->n, this->kd, 1, this->band.data(), this->kd + 1, x.data(), this->n);
+    if(info != 0){
+        print_line("ERROR: banded Cholesky solve failed (info = " + std::to_string(info) + ").");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void BandCholesky::solve(Eigen::MatrixXd& X, const Eigen::MatrixXd& B) const{
+    X = B.topRows(this->n);
+    if(this->n == 0){
+        return;
+    }
+    const auto info = LAPACKE_dpbtrs(LAPACK_COL_MAJOR, 'L', this->n, this->kd, X.cols(), this->band.data(), this->kd + 1, X.data(), this->n);
+    if(info != 0){
+        print_line("ERROR: banded Cholesky solve failed (info = " + std::to_string(info) + ").");
+        exit(EXIT_FAILURE);
+    }
+}
+
+}
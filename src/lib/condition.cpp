@@ -0,0 +1,168 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <Eigen/Eigenvalues>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include "lib/condition.hpp"
+
+namespace dplib{
+
+namespace{
+
+// Extreme eigenvalues of the symmetric tridiagonal matrix with diagonal a
+// and subdiagonal b
+ConditionEstimate tridiagonal_extremes(const Eigen::VectorXd& a, const Eigen::VectorXd& b){
+    ConditionEstimate c;
+    c.steps = a.size();
+    if(a.size() == 0){
+        return c;
+    }
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eig;
+    eig.computeFromTridiagonal(a, b, Eigen::EigenvaluesOnly);
+    c.lambda_min = eig.eigenvalues()[0];
+    c.lambda_max = eig.eigenvalues()[a.size() - 1];
+    c.condition = c.lambda_max/c.lambda_min;
+    return c;
+}
+
+// Hager's estimate of ||B||_1 for a symmetric B, with Higham's extra
+// test vector against the cases where it stops too early
+double norm1(const std::function<void(const Eigen::VectorXd&, Eigen::VectorXd&)>& B, std::ptrdiff_t n, size_t max_steps, size_t& steps){
+    Eigen::VectorXd x = Eigen::VectorXd::Constant(n, 1.0/n);
+    Eigen::VectorXd y(n), xi(n), z(n);
+    double est = 0;
+    for(size_t k = 0; k < max_steps; ++k){
+        B(x, y);
+        ++steps;
+        const double est_new = y.lpNorm<1>();
+        if(k > 0 && est_new <= est){
+            break;
+        }
+        est = est_new;
+        for(std::ptrdiff_t i = 0; i < n; ++i){
+            xi[i] = (y[i] >= 0) ? 1.0 : -1.0;
+        }
+        B(xi, z);
+        ++steps;
+        std::ptrdiff_t j = 0;
+        const double z_max = z.cwiseAbs().maxCoeff(&j);
+        if(k > 0 && z_max <= z.dot(x)){
+            break;
+        }
+        x.setZero();
+        x[j] = 1;
+    }
+    for(std::ptrdiff_t i = 0; i < n; ++i){
+        x[i] = ((i % 2 == 0) ? 1.0 : -1.0)*(1.0 + static_cast<double>(i)/std::max<std::ptrdiff_t>(n - 1, 1));
+    }
+    B(x, y);
+    ++steps;
+    return std::max(est, 2*y.lpNorm<1>()/(3*n));
+}
+
+}
+
+std::string ConditionEstimate::to_string() const{
+    std::ostringstream s;
+    s << "lambda_min = " << this->lambda_min << ", lambda_max = " << this->lambda_max
+      << ", condition = " << this->condition << " (" << this->steps << " steps)";
+    return s.str();
+}
+
+ConditionEstimate lanczos_condition(const LinearOperator& A, size_t steps){
+    const std::ptrdiff_t n = A.size();
+    steps = std::min<size_t>(steps, n);
+
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    Eigen::VectorXd v(n), v_old = Eigen::VectorXd::Zero(n), w(n);
+    for(auto& vi:v){
+        vi = dist(gen);
+    }
+    v.normalize();
+
+    Eigen::VectorXd a(steps), b(steps);
+    double beta = 0;
+    size_t k = 0;
+    for(; k < steps; ++k){
+        A.apply(v, w);
+        w -= beta*v_old;
+        a[k] = w.dot(v);
+        w -= a[k]*v;
+        beta = w.norm();
+        b[k] = beta;
+        // Invariant subspace, the Ritz values are exact
+        if(beta <= 1e-14*std::abs(a[k])){
+            ++k;
+            break;
+        }
+        v_old.swap(v);
+        v = w/beta;
+    }
+    return tridiagonal_extremes(a.head(k), b.head(std::max<size_t>(k, 1) - 1));
+}
+
+ConditionEstimate lanczos_condition(const SparseMatrix& M, size_t L, size_t steps){
+    SparseOperator A;
+    LinearOperator::Mat K;
+    if(M.is_compressed() && M.matrix_size() == L){
+        A.set_matrix(M.eigen_map());
+    } else {
+        K.resize(L, L);
+        M.to_eigen_sparse(K);
+        A.set_matrix(K);
+    }
+    return lanczos_condition(A, steps);
+}
+
+ConditionEstimate cg_condition(const std::vector<double>& alpha, const std::vector<double>& beta){
+    const std::ptrdiff_t k = alpha.size();
+    if(k == 0){
+        return ConditionEstimate();
+    }
+    Eigen::VectorXd a(k), b(k - 1);
+    for(std::ptrdiff_t j = 0; j < k; ++j){
+        a[j] = 1.0/alpha[j];
+        if(j > 0){
+            a[j] += beta[j-1]/alpha[j-1];
+            b[j-1] = std::sqrt(beta[j-1])/alpha[j-1];
+        }
+    }
+    return tridiagonal_extremes(a, b);
+}
+
+ConditionEstimate hager_condition(const LinearOperator& A, const std::function<void(const Eigen::VectorXd&, Eigen::VectorXd&)>& solve, size_t max_steps){
+    const std::ptrdiff_t n = A.size();
+    size_t products = 0;
+    const double norm = norm1([&A](const Eigen::VectorXd& x, Eigen::VectorXd& y){
+        A.apply(x, y);
+    }, n, max_steps, products);
+    ConditionEstimate c;
+    const double inv_norm = norm1(solve, n, max_steps, c.steps);
+    c.lambda_max = norm;
+    c.lambda_min = 1.0/inv_norm;
+    c.condition = norm*inv_norm;
+    return c;
+}
+
+}
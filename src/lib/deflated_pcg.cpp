@@ -0,0 +1,192 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include "lib/deflated_pcg.hpp"
+#include "lib/print.hpp"
+
+namespace dplib{
+
+void DeflatedPCG::set_K(SparseMatrix& M, size_t L){
+    if(M.is_compressed() && M.matrix_size() == L){
+        // Works on M's arrays directly
+        this->K = Mat();
+        this->sparse_op.set_matrix(M.eigen_map());
+    } else {
+        this->K.resize(L, L);
+        M.to_eigen_sparse(this->K);
+        this->sparse_op.set_matrix(this->K);
+    }
+    this->A = &this->sparse_op;
+}
+
+void DeflatedPCG::set_K(const LinearOperator& A){
+    this->A = &A;
+}
+
+void DeflatedPCG::set_deflation(const std::vector<long>& group){
+    this->group = group;
+    this->m = 0;
+    for(const auto g:group){
+        if(g >= static_cast<long>(this->m)){
+            this->m = g + 1;
+        }
+    }
+}
+
+void DeflatedPCG::compute(){
+    if(this->A == nullptr){
+        print_line("ERROR: DeflatedPCG needs K before compute().");
+        exit(EXIT_FAILURE);
+    }
+    if(this->group.size() != this->A->size()){
+        print_line("ERROR: DeflatedPCG deflation groups do not match the size of K.");
+        exit(EXIT_FAILURE);
+    }
+    Preconditioner* P = (this->P != nullptr) ? this->P : &this->jacobi;
+    P->compute(*this->A);
+
+    this->build_KZ();
+    // E = Z^T*K*Z
+    Eigen::MatrixXd E = Eigen::MatrixXd::Zero(this->m, this->m);
+    for(std::ptrdiff_t j = 0; j < this->KZ.outerSize(); ++j){
+        for(Mat::InnerIterator it(this->KZ, j); it; ++it){
+            const long g = this->group[it.row()];
+            if(g > -1){
+                E(g, j) += it.value();
+            }
+        }
+    }
+    this->E.compute(E);
+}
+
+void DeflatedPCG::build_KZ(){
+    const std::ptrdiff_t n = this->A->size();
+    const auto* K = this->A->matrix();
+    std::vector<Eigen::Triplet<double, std::ptrdiff_t>> entries;
+    if(K != nullptr){
+        // Column j of K*Z sums the columns of K in group j, read from both
+        // triangles of the stored lower one
+        entries.reserve(2*K->nonZeros());
+        for(std::ptrdiff_t c = 0; c < K->outerSize(); ++c){
+            for(LinearOperator::MatMap::InnerIterator it(*K, c); it; ++it){
+                const std::ptrdiff_t r = it.row();
+                if(this->group[c] > -1){
+                    entries.emplace_back(r, this->group[c], it.value());
+                }
+                if(r != c && this->group[r] > -1){
+                    entries.emplace_back(c, this->group[r], it.value());
+                }
+            }
+        }
+    } else {
+        // One product per deflation vector
+        Eigen::VectorXd z(n), y(n);
+        for(size_t j = 0; j < this->m; ++j){
+            for(std::ptrdiff_t i = 0; i < n; ++i){
+                z[i] = (this->group[i] == static_cast<long>(j)) ? 1.0 : 0.0;
+            }
+            this->A->apply(z, y);
+            for(std::ptrdiff_t i = 0; i < n; ++i){
+                if(y[i] != 0){
+                    entries.emplace_back(i, j, y[i]);
+                }
+            }
+        }
+    }
+    this->KZ.resize(n, this->m);
+    this->KZ.setFromTriplets(entries.begin(), entries.end());
+}
+
+Eigen::VectorXd DeflatedPCG::restrict(const Eigen::VectorXd& v) const{
+    Eigen::VectorXd s = Eigen::VectorXd::Zero(this->m);
+    for(std::ptrdiff_t i = 0; i < v.size(); ++i){
+        if(this->group[i] > -1){
+            s[this->group[i]] += v[i];
+        }
+    }
+    return s;
+}
+
+void DeflatedPCG::subtract_prolonged(const Eigen::VectorXd& mu, Eigen::VectorXd& v) const{
+    for(std::ptrdiff_t i = 0; i < v.size(); ++i){
+        if(this->group[i] > -1){
+            v[i] -= mu[this->group[i]];
+        }
+    }
+}
+
+void DeflatedPCG::solve(std::vector<double>& x, std::vector<double>& b){
+    Eigen::VectorXd u;
+    this->solve(u, Eigen::Map<const Eigen::VectorXd>(b.data(), b.size()));
+    std::copy(u.cbegin(), u.cend(), x.begin());
+}
+
+void DeflatedPCG::solve(Eigen::VectorXd& x, const Eigen::VectorXd& b){
+    const Preconditioner* P = (this->P != nullptr) ? this->P : &this->jacobi;
+    const std::ptrdiff_t n = b.size();
+    const size_t max_it = (this->max_it > 0) ? this->max_it : 2*n;
+    this->it = 0;
+    this->err = 0;
+
+    // Coarse part of the solution, after which Z^T*r = 0 and stays so
+    Eigen::VectorXd mu = this->E.solve(this->restrict(b));
+    x = Eigen::VectorXd::Zero(n);
+    this->subtract_prolonged(-mu, x);
+    Eigen::VectorXd r = b - this->KZ*mu;
+
+    const double b_norm = b.norm();
+    if(b_norm == 0){
+        x.setZero();
+        return;
+    }
+    this->err = r.norm()/b_norm;
+    if(this->err <= this->tol){
+        return;
+    }
+
+    Eigen::VectorXd z(n), w(n);
+    P->apply(r, z);
+    // p = z - Z*E^-1*(K*Z)^T*z, K-orthogonal to Z
+    Eigen::VectorXd p = z;
+    this->subtract_prolonged(this->E.solve(this->KZ.transpose()*z), p);
+    double rz = r.dot(z);
+    while(this->it < max_it){
+        this->A->apply(p, w);
+        const double alpha = rz/p.dot(w);
+        x += alpha*p;
+        r -= alpha*w;
+        ++this->it;
+        this->err = r.norm()/b_norm;
+        if(this->err <= this->tol){
+            break;
+        }
+        P->apply(r, z);
+        const double rz_new = r.dot(z);
+        const double beta = rz_new/rz;
+        rz = rz_new;
+        p = beta*p + z;
+        this->subtract_prolonged(this->E.solve(this->KZ.transpose()*z), p);
+    }
+}
+
+}
@@ -0,0 +1,432 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include "lib/distributed_mesh.hpp"
+#include "lib/print.hpp"
+#include "lib/Q4.hpp"
+
+namespace dplib{
+
+DistributedMesh::DistributedMesh(MPI_Comm comm, size_t W, size_t H, double t, double elem_size):
+    comm(comm), W(W), H(H), element_size(elem_size), t(t){
+
+    MPI_Comm_rank(comm, &this->id);
+    MPI_Comm_size(comm, &this->ranks);
+    if(static_cast<size_t>(this->ranks) > H+1){
+        print_line("ERROR: DistributedMesh has more ranks than rows of nodes.");
+        MPI_Abort(comm, EXIT_FAILURE);
+    }
+    this->row_begin.resize(this->ranks+1);
+    for(int r = 0; r <= this->ranks; ++r){
+        this->row_begin[r] = (r*(H+1))/this->ranks;
+    }
+    this->y0 = this->row_begin[this->id];
+    this->y1 = this->row_begin[this->id+1];
+    this->w0 = this->y0;
+    this->w1 = this->y1;
+}
+
+void DistributedMesh::apply_Dirichlet(double d, Point begin, Point end){
+    this->dirichlet.push_back({d, begin, end});
+}
+
+void DistributedMesh::apply_Neumann(double d, Point begin, Point end){
+    if(begin.x == end.x && begin.x == W+1){
+        begin.x -= 1;
+        end.x -= 1;
+    }
+    if(begin.y == end.y && begin.y == H+1){
+        begin.y -= 1;
+        end.y -= 1;
+    }
+    this->neumann.push_back({d, begin, end});
+}
+
+void DistributedMesh::mark_dirichlet(){
+    const size_t n = this->nodes(this->w1 - this->w0);
+    this->fixed.assign(n, 0);
+    this->fixed_value.assign(n, 0);
+    // Later boundaries override earlier ones, as in RectangularMesh
+    for(auto b:this->dirichlet){
+        if(b.begin.x == b.end.x && b.begin.x == W+1){
+            b.begin.x -= 1;
+            b.end.x -= 1;
+        }
+        if(b.begin.y == b.end.y && b.begin.y == H+1){
+            b.begin.y -= 1;
+            b.end.y -= 1;
+        }
+        for(size_t x = b.begin.x; x < b.end.x || (x == b.begin.x && x == b.end.x); ++x){
+            for(size_t y = b.begin.y; y < b.end.y || (y == b.begin.y && y == b.end.y); ++y){
+                if(y >= this->w0 && y < this->w1){
+                    const size_t i = this->offset(y) + x;
+                    this->fixed[i] = 1;
+                    this->fixed_value[i] = b.d;
+                }
+            }
+        }
+    }
+}
+
+double DistributedMesh::ring(const Point& p, double min) const{
+    const Point center{W/2.0, H/2.0, 0};
+
+    const double dist = center.distance(p);
+    const double ri = std::min(W, H)/6.0;
+    const double ro = 2*ri;
+    if(dist >= ri && dist <= ro){
+        return min;
+    } else {
+        return 1;
+    }
+}
+
+template<typename F>
+void DistributedMesh::for_each_element(size_t e0, size_t e1, const std::vector<double>& k, double K_MIN, F f) const{
+    std::vector<double> M(k.size());
+    size_t n[4];
+    for(size_t y = e0; y < e1; ++y){
+        for(size_t x = 0; x < W; ++x){
+            const size_t base = x + y*(W+1);
+            // Same node order as RectangularMesh's elements
+            n[0] = base+W+1;
+            n[1] = base+W+2;
+            n[2] = base+1;
+            n[3] = base;
+            const Point p{static_cast<double>(x), static_cast<double>(y), 0.0};
+            const double rho = this->ring(p, K_MIN);
+            for(size_t i = 0; i < k.size(); ++i){
+                M[i] = rho*k[i];
+            }
+            f(n, M);
+        }
+    }
+}
+
+void DistributedMesh::generate_K(const double K_MIN){
+    if(this->schwarz){
+        // Every subdomain must only reach into its neighbours' rows
+        for(int r = 0; r < this->ranks; ++r){
+            if(this->row_begin[r+1] - this->row_begin[r] < this->overlap){
+                if(this->id == 0){
+                    print_line("ERROR: DistributedMesh overlap is larger than the rows of a rank.");
+                }
+                MPI_Abort(this->comm, EXIT_FAILURE);
+            }
+        }
+    }
+    const size_t halo = this->schwarz ? std::max<size_t>(this->overlap, 1) : 1;
+    this->w0 = this->y0 - std::min(halo, this->y0);
+    this->w1 = std::min(this->y1 + halo, H+1);
+    this->mark_dirichlet();
+
+    if(this->id == 0){
+        print_line("DistributedMesh: generating global matrix and Dirichlet vector...");
+    }
+    std::vector<double> A{1.0, 0.0,
+                          0.0, 1.0};
+    const auto k = dplib::Q4::get_diffusion_2D(this->t, this->element_size/2, this->element_size/2, A);
+
+    const size_t own = this->nodes(this->y1 - this->y0);
+    const size_t first_node = this->nodes(this->y0);
+    const size_t window_first = this->nodes(this->w0);
+    this->load.setZero(own);
+    std::vector<Eigen::Triplet<double, std::ptrdiff_t>> entries;
+    entries.reserve(9*own);
+    // The row of elements below the own nodes is also needed for them
+    this->for_each_element(std::max<size_t>(this->y0, 1) - 1, std::min(this->y1, H), k, K_MIN,
+        [&](const size_t* n, const std::vector<double>& M){
+            for(size_t a = 0; a < 4; ++a){
+                if(n[a] < first_node || n[a] >= first_node + own || this->fixed[n[a] - window_first]){
+                    continue;
+                }
+                const size_t i = n[a] - first_node;
+                for(size_t b = 0; b < 4; ++b){
+                    const size_t j = n[b] - window_first;
+                    if(this->fixed[j]){
+                        this->load[i] -= M[a*4+b]*this->fixed_value[j];
+                    } else {
+                        entries.emplace_back(i, j, M[a*4+b]);
+                    }
+                }
+            }
+        });
+    const size_t diagonal = first_node - window_first;
+    for(size_t i = 0; i < own; ++i){
+        if(this->fixed[diagonal + i]){
+            entries.emplace_back(i, diagonal + i, 1.0);
+            this->load[i] = this->fixed_value[diagonal + i];
+        }
+    }
+    this->K.resize(own, this->nodes(this->w1 - this->w0));
+    this->K.setFromTriplets(entries.begin(), entries.end());
+
+    for(const auto& n:this->neumann){
+        const Point& begin = n.begin;
+        const Point& end = n.end;
+        const double de = n.d/(begin.distance(end)*this->element_size);
+        bool first = true;
+        bool last = false;
+        for(size_t x = begin.x; x < end.x || (x == begin.x && x == end.x); ++x){
+            if(begin.x != end.x && x + 1 == end.x){
+                last = true;
+            }
+            for(size_t y = begin.y; y < end.y || (y == begin.y && y == end.y); ++y){
+                if(begin.y != end.y && y + 1 == end.y){
+                    last = true;
+                }
+                if(y < this->y0 || y >= this->y1 || this->fixed[this->offset(y) + x]){
+                    continue;
+                }
+                const size_t i = this->nodes(y - this->y0) + x;
+                if(first || last){
+                    this->load[i] += de*this->element_size/2;
+                } else {
+                    this->load[i] += de*this->element_size;
+                }
+            }
+        }
+    }
+
+    this->psi = Eigen::Map<const Eigen::VectorXd>(this->fixed_value.data(), this->fixed_value.size());
+    this->inv_diag.resize(own);
+    for(size_t i = 0; i < own; ++i){
+        this->inv_diag[i] = 1.0/this->K.coeff(i, diagonal + i);
+    }
+
+    if(this->schwarz){
+        this->setup_schwarz(k, K_MIN);
+    }
+}
+
+void DistributedMesh::setup_schwarz(const std::vector<double>& k, double K_MIN){
+    this->s0 = this->y0 - std::min(this->overlap, this->y0);
+    this->s1 = std::min(this->y1 + this->overlap, H+1);
+    const size_t size = this->nodes(this->s1 - this->s0);
+    const size_t first = this->nodes(this->s0);
+    const size_t window_first = this->nodes(this->w0);
+
+    // Principal submatrix of K on the subdomain, lower triangle, with
+    // zero Dirichlet conditions on its rows beyond the grid's
+    std::vector<Eigen::Triplet<double, std::ptrdiff_t>> entries;
+    entries.reserve(5*size);
+    this->for_each_element(std::max<size_t>(this->s0, 1) - 1, std::min(this->s1, H), k, K_MIN,
+        [&](const size_t* n, const std::vector<double>& M){
+            for(size_t a = 0; a < 4; ++a){
+                if(n[a] < first || n[a] >= first + size || this->fixed[n[a] - window_first]){
+                    continue;
+                }
+                for(size_t b = 0; b < 4; ++b){
+                    if(n[b] < first || n[b] > n[a] || this->fixed[n[b] - window_first]){
+                        continue;
+                    }
+                    entries.emplace_back(n[a] - first, n[b] - first, M[a*4+b]);
+                }
+            }
+        });
+    for(size_t i = 0; i < size; ++i){
+        if(this->fixed[first - window_first + i]){
+            entries.emplace_back(i, i, 1.0);
+        }
+    }
+    EigenCholesky::Mat Ks(size, size);
+    Ks.setFromTriplets(entries.begin(), entries.end());
+    this->local.set_K(Ks);
+    this->local.compute();
+
+    if(!this->coarse){
+        return;
+    }
+    // E = Z^T*K*Z with one constant per rank over its free nodes. Each
+    // rank adds the entries of its own rows, which only reach the ranks
+    // next to it.
+    Eigen::MatrixXd E = Eigen::MatrixXd::Zero(this->ranks, this->ranks);
+    const size_t diagonal = this->nodes(this->y0) - window_first;
+    for(std::ptrdiff_t i = 0; i < this->K.outerSize(); ++i){
+        if(this->fixed[diagonal + i]){
+            continue;
+        }
+        for(RowMat::InnerIterator it(this->K, i); it; ++it){
+            const size_t y = this->w0 + it.col()/(W+1);
+            const int r = (y < this->y0) ? this->id - 1 : ((y < this->y1) ? this->id : this->id + 1);
+            E(this->id, r) += it.value();
+        }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, E.data(), E.size(), MPI_DOUBLE, MPI_SUM, this->comm);
+    for(int r = 0; r < this->ranks; ++r){
+        // Ranks with only Dirichlet nodes
+        if(E(r, r) == 0){
+            E(r, r) = 1;
+        }
+    }
+    this->E.compute(E);
+}
+
+void DistributedMesh::exchange(Eigen::VectorXd& v, size_t rows) const{
+    if(rows == 0){
+        return;
+    }
+    const int below = (this->id > 0) ? this->id - 1 : MPI_PROC_NULL;
+    const int above = (this->id + 1 < this->ranks) ? this->id + 1 : MPI_PROC_NULL;
+    const int n = this->nodes(rows);
+    double* own_bottom = v.data() + this->offset(this->y0);
+    double* own_top = v.data() + this->offset(this->y1 - rows);
+    // Halos only exist on the sides with a neighbour; MPI_PROC_NULL
+    // transfers nothing but still wants a valid buffer
+    double* halo_below = (below != MPI_PROC_NULL) ? v.data() + this->offset(this->y0 - rows) : v.data();
+    double* halo_above = (above != MPI_PROC_NULL) ? v.data() + this->offset(this->y1) : v.data();
+
+    MPI_Sendrecv(own_top, n, MPI_DOUBLE, above, 0, halo_below, n, MPI_DOUBLE, below, 0, this->comm, MPI_STATUS_IGNORE);
+    MPI_Sendrecv(own_bottom, n, MPI_DOUBLE, below, 1, halo_above, n, MPI_DOUBLE, above, 1, this->comm, MPI_STATUS_IGNORE);
+}
+
+void DistributedMesh::accumulate(Eigen::VectorXd& v, size_t rows) const{
+    if(rows == 0){
+        return;
+    }
+    const int below = (this->id > 0) ? this->id - 1 : MPI_PROC_NULL;
+    const int above = (this->id + 1 < this->ranks) ? this->id + 1 : MPI_PROC_NULL;
+    const int n = this->nodes(rows);
+    double* halo_below = (below != MPI_PROC_NULL) ? v.data() + this->offset(this->y0 - rows) : v.data();
+    double* halo_above = (above != MPI_PROC_NULL) ? v.data() + this->offset(this->y1) : v.data();
+    Eigen::VectorXd from_below = Eigen::VectorXd::Zero(n);
+    Eigen::VectorXd from_above = Eigen::VectorXd::Zero(n);
+
+    MPI_Sendrecv(halo_above, n, MPI_DOUBLE, above, 2, from_below.data(), n, MPI_DOUBLE, below, 2, this->comm, MPI_STATUS_IGNORE);
+    MPI_Sendrecv(halo_below, n, MPI_DOUBLE, below, 3, from_above.data(), n, MPI_DOUBLE, above, 3, this->comm, MPI_STATUS_IGNORE);
+    v.segment(this->offset(this->y0), n) += from_below;
+    v.segment(this->offset(this->y1 - rows), n) += from_above;
+}
+
+double DistributedMesh::dot(const Eigen::VectorXd& a, const Eigen::VectorXd& b) const{
+    double d = a.dot(b);
+    MPI_Allreduce(MPI_IN_PLACE, &d, 1, MPI_DOUBLE, MPI_SUM, this->comm);
+    return d;
+}
+
+void DistributedMesh::multiply(Eigen::VectorXd& x, Eigen::VectorXd& y) const{
+    this->exchange(x, 1);
+    y.noalias() = this->K*x;
+}
+
+void DistributedMesh::precondition(const Eigen::VectorXd& r, Eigen::VectorXd& z) const{
+    if(!this->schwarz){
+        z = this->inv_diag.cwiseProduct(r);
+        return;
+    }
+    const size_t own = r.size();
+    Eigen::VectorXd v = Eigen::VectorXd::Zero(this->psi.size());
+    v.segment(this->offset(this->y0), own) = r;
+    this->exchange(v, this->overlap);
+
+    const size_t size = this->nodes(this->s1 - this->s0);
+    Eigen::VectorXd u;
+    this->local.solve(u, v.segment(this->offset(this->s0), size));
+    v.setZero();
+    v.segment(this->offset(this->s0), size) = u;
+    this->accumulate(v, this->overlap);
+    z = v.segment(this->offset(this->y0), own);
+
+    if(!this->coarse){
+        return;
+    }
+    const size_t diagonal = this->offset(this->y0);
+    Eigen::VectorXd c = Eigen::VectorXd::Zero(this->ranks);
+    for(size_t i = 0; i < own; ++i){
+        if(!this->fixed[diagonal + i]){
+            c[this->id] += r[i];
+        }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, c.data(), c.size(), MPI_DOUBLE, MPI_SUM, this->comm);
+    c = this->E.solve(c);
+    for(size_t i = 0; i < own; ++i){
+        if(!this->fixed[diagonal + i]){
+            z[i] += c[this->id];
+        }
+    }
+}
+
+void DistributedMesh::solve(){
+    if(this->id == 0){
+        print_line("DistributedMesh: solving with distributed PCG...");
+    }
+    const size_t own = this->load.size();
+    const size_t diagonal = this->offset(this->y0);
+    const size_t max_it = (this->max_it > 0) ? this->max_it : 2*this->nodes(H+1);
+
+    // psi starts with the Dirichlet values, so their rows have no residual
+    Eigen::VectorXd p = this->psi;
+    Eigen::VectorXd q(own);
+    this->multiply(p, q);
+    Eigen::VectorXd r = this->load - q;
+    Eigen::VectorXd z(own);
+    this->precondition(r, z);
+    p.setZero();
+    p.segment(diagonal, own) = z;
+
+    const double b_norm = std::sqrt(this->dot(this->load, this->load));
+    double r_norm = std::sqrt(this->dot(r, r));
+    double rz = this->dot(r, z);
+    this->it = 0;
+    while(b_norm > 0 && r_norm > this->tol*b_norm && this->it < max_it){
+        this->multiply(p, q);
+        const double alpha = rz/this->dot(p.segment(diagonal, own), q);
+        this->psi.segment(diagonal, own) += alpha*p.segment(diagonal, own);
+        r -= alpha*q;
+        this->precondition(r, z);
+        const double rz_new = this->dot(r, z);
+        p.segment(diagonal, own) = z + (rz_new/rz)*p.segment(diagonal, own);
+        rz = rz_new;
+        r_norm = std::sqrt(this->dot(r, r));
+        ++this->it;
+    }
+    this->err = (b_norm > 0) ? r_norm/b_norm : 0;
+}
+
+std::vector<double> DistributedMesh::get_result(){
+    this->exchange(this->psi, 1);
+
+    // Each rank has the rows of elements starting at its rows of nodes
+    const size_t e0 = this->y0;
+    const size_t e1 = std::min(this->y1, H);
+    std::vector<double> local((e1 - e0)*W, 0);
+    for(size_t y = e0; y < e1; ++y){
+        for(size_t x = 0; x < W; ++x){
+            const size_t n = this->offset(y) + x;
+            local[(y - e0)*W + x] = (this->psi[n] + this->psi[n+1] + this->psi[n+W+1] + this->psi[n+W+2])/4;
+        }
+    }
+
+    std::vector<int> counts(this->ranks), displs(this->ranks);
+    for(int r = 0; r < this->ranks; ++r){
+        counts[r] = (std::min(this->row_begin[r+1], H) - std::min(this->row_begin[r], H))*W;
+        displs[r] = std::min(this->row_begin[r], H)*W;
+    }
+    std::vector<double> result((this->id == 0) ? W*H : 0);
+    MPI_Gatherv(local.data(), local.size(), MPI_DOUBLE, result.data(), counts.data(), displs.data(), MPI_DOUBLE, 0, this->comm);
+
+    return result;
+}
+
+}
@@ -18,51 +18,661 @@
  *
  */
 
+#include <Eigen/Eigenvalues>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include "lib/eigen.hpp"
+#include "lib/print.hpp"
+#include "lib/timer.hpp"
 
 namespace dplib{
 
 void EigenPCG::set_K(SparseMatrix& M, size_t L){
-    std::fill(this->K.valuePtr(), this->K.valuePtr() + this->K.nonZeros(), 0);
-    if(this->first_time){
-        this->K = Mat(L, L);
+    if(M.is_compressed() && M.matrix_size() == L){
+        // Works on M's arrays directly
+        this->K = Mat();
+        this->sparse_op.set_matrix(M.eigen_map());
+    } else {
+        this->K.resize(L, L);
+        M.to_eigen_sparse(this->K);
+        this->sparse_op.set_matrix(this->K);
     }
-    M.to_eigen_sparse(this->K);
+    this->A = &this->sparse_op;
+}
+
+void EigenPCG::set_K(const LinearOperator& A){
+    this->A = &A;
 }
 
 void EigenPCG::compute(){
-    this->cg.compute(this->K);
+    Preconditioner* P = (this->P != nullptr) ? this->P : &this->jacobi;
+    P->compute(*this->A);
+    this->op.set(this->A);
+    this->cg.preconditioner().set(P);
+    this->cg.compute(this->op);
 }
 
 void EigenPCG::solve(std::vector<double>& x, std::vector<double>& b){
     Eigen::VectorXd f = Eigen::Map<Eigen::VectorXd, Eigen::Unaligned>(b.data(), b.size());
     Eigen::VectorXd u = Eigen::Map<Eigen::VectorXd, Eigen::Unaligned>(x.data(), x.size());
 
-    u = this->cg.solveWithGuess(f, u);
+    if(this->own_loop()){
+        this->solve_recording(u, f);
+        if(this->estimate_condition){
+            print_line("PCG: " + this->condition.to_string());
+        }
+    } else {
+        u = this->cg.solveWithGuess(f, u);
+    }
 
     std::copy(u.cbegin(), u.cend(), x.begin());
 }
 
+void EigenPCG::solve_recording(Eigen::VectorXd& x, const Eigen::VectorXd& b){
+    const Preconditioner* P = (this->P != nullptr) ? this->P : &this->jacobi;
+    const double tol = this->cg.tolerance();
+    const size_t max_it = this->cg.maxIterations();
+    std::vector<double> alpha, beta;
+    this->it = 0;
+    this->err = 0;
+    this->condition = ConditionEstimate();
+
+    const double b_norm2 = b.squaredNorm();
+    if(b_norm2 == 0){
+        x.setZero();
+        return;
+    }
+    Eigen::VectorXd r(b.size()), z(b.size()), w(b.size());
+    this->A->apply(x, w);
+    r = b - w;
+    const double threshold = std::max(tol*tol*b_norm2, std::numeric_limits<double>::min());
+    double r_norm2 = r.squaredNorm();
+    if(r_norm2 < threshold){
+        this->err = std::sqrt(r_norm2/b_norm2);
+        return;
+    }
+    P->apply(r, z);
+    Eigen::VectorXd p = z;
+    double rz = r.dot(z);
+    size_t i = 0;
+    while(i < max_it){
+        this->A->apply(p, w);
+        const double a = rz/p.dot(w);
+        alpha.push_back(a);
+        x += a*p;
+        if(this->callback){
+            this->callback(alpha.size(), x);
+        }
+        r -= a*w;
+        r_norm2 = r.squaredNorm();
+        if(r_norm2 < threshold){
+            break;
+        }
+        P->apply(r, z);
+        const double rz_new = r.dot(z);
+        beta.push_back(rz_new/rz);
+        rz = rz_new;
+        p = z + beta.back()*p;
+        ++i;
+    }
+    this->it = i;
+    this->err = std::sqrt(r_norm2/b_norm2);
+    this->condition = cg_condition(alpha, beta);
+}
+
 // CHOLESKY
 
 void EigenCholesky::set_K(SparseMatrix& M, size_t L){
-    std::fill(this->K.valuePtr(), this->K.valuePtr() + this->K.nonZeros(), 0);
-    if(this->first_time){
+    if(M.is_compressed() && M.matrix_size() == L){
+        // Works on M's arrays directly, so a new pattern is only detected
+        // through its revision
+        if(this->source != &M || this->revision != M.pattern_revision()){
+            this->first_time = true;
+            this->source = &M;
+            this->revision = M.pattern_revision();
+        }
+        this->K = Mat();
+        this->K_map.emplace(M.eigen_map());
+        return;
+    }
+    this->source = nullptr;
+    if(this->first_time || static_cast<size_t>(this->K.rows()) != L || !M.update_eigen_values(this->K)){
+        this->first_time = true;
         this->K = Mat(L, L);
+        M.to_eigen_sparse(this->K);
     }
-    M.to_eigen_sparse(this->K);
+    this->map_K();
+}
+
+void EigenCholesky::set_K(const Mat& K){
+    this->source = nullptr;
+    if(!this->first_time && this->K.rows() == K.rows() && this->K.nonZeros() == K.nonZeros() && K.isCompressed()){
+        if(std::equal(K.outerIndexPtr(), K.outerIndexPtr() + K.outerSize() + 1, this->K.outerIndexPtr()) &&
+           std::equal(K.innerIndexPtr(), K.innerIndexPtr() + K.nonZeros(), this->K.innerIndexPtr())){
+            std::copy(K.valuePtr(), K.valuePtr() + K.nonZeros(), this->K.valuePtr());
+            this->map_K();
+            return;
+        }
+    }
+    this->first_time = true;
+    this->K = K;
+    this->K.makeCompressed();
+    this->map_K();
+}
+
+void EigenCholesky::map_K(){
+    this->K_map.emplace(this->K.rows(), this->K.cols(), this->K.nonZeros(), this->K.outerIndexPtr(), this->K.innerIndexPtr(), this->K.valuePtr());
+}
+
+void EigenCholesky::modify(const std::vector<long>& pos, const std::vector<double>& M){
+    const size_t W = pos.size();
+    Modification m;
+    std::vector<size_t> local;
+    for(size_t i = 0; i < W; ++i){
+        if(pos[i] > -1){
+            m.pos.push_back(pos[i]);
+            local.push_back(i);
+        }
+    }
+    const std::ptrdiff_t F = local.size();
+    if(F == 0){
+        return;
+    }
+    Eigen::MatrixXd A(F, F);
+    for(std::ptrdiff_t i = 0; i < F; ++i){
+        for(std::ptrdiff_t j = 0; j < F; ++j){
+            A(i, j) = M[local[i]*W + local[j]];
+        }
+    }
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eig(A);
+    const Eigen::VectorXd& lambda = eig.eigenvalues();
+    // Drops the null space (e.g. the constant mode of a diffusion element)
+    const double tol = 1e-12*lambda.cwiseAbs().maxCoeff();
+    std::vector<std::ptrdiff_t> terms;
+    for(std::ptrdiff_t c = 0; c < F; ++c){
+        if(std::abs(lambda[c]) > tol){
+            terms.push_back(c);
+        }
+    }
+    if(terms.empty()){
+        return;
+    }
+    m.V.resize(F, terms.size());
+    m.sigma.resize(terms.size());
+    for(size_t c = 0; c < terms.size(); ++c){
+        m.V.col(c) = eig.eigenvectors().col(terms[c]);
+        m.sigma[c] = lambda[terms[c]];
+    }
+    this->pending_rank += terms.size();
+    this->modifications.push_back(std::move(m));
+}
+
+bool EigenCholesky::worth_updating() const{
+    if(this->update_limit > 0){
+        return this->pending_rank <= this->update_limit;
+    }
+    const double limit = this->solver.factor_cost();
+    double cost = 0;
+    for(const auto& m:this->modifications){
+        std::ptrdiff_t first = this->K_map->rows();
+        for(const auto i:m.pos){
+            first = std::min(first, this->solver.position(i));
+        }
+        cost += m.sigma.size()*this->solver.update_cost(first);
+        if(cost > limit){
+            return false;
+        }
+    }
+    return true;
+}
+
+bool EigenCholesky::update_factor(){
+    const std::ptrdiff_t n = this->K_map->rows();
+    std::vector<std::ptrdiff_t> terms;
+    std::vector<double> sigma;
+    // Updates first, so that the intermediate factors stay as well
+    // conditioned as possible
+    for(const bool positive:{true, false}){
+        for(const auto& m:this->modifications){
+            terms.clear();
+            sigma.clear();
+            for(std::ptrdiff_t c = 0; c < m.sigma.size(); ++c){
+                if((m.sigma[c] > 0) == positive){
+                    terms.push_back(c);
+                    sigma.push_back(m.sigma[c]);
+                }
+            }
+            const std::ptrdiff_t k = terms.size();
+            if(k == 0){
+                continue;
+            }
+            if(this->work.size() < static_cast<size_t>(n*k)){
+                this->work.resize(n*k, 0.0);
+            }
+            std::ptrdiff_t first = n;
+            for(size_t i = 0; i < m.pos.size(); ++i){
+                const std::ptrdiff_t r = this->solver.position(m.pos[i]);
+                first = std::min(first, r);
+                for(std::ptrdiff_t c = 0; c < k; ++c){
+                    this->work[r*k + c] = m.V(i, terms[c]);
+                }
+            }
+            if(!this->solver.update(this->work.data(), k, sigma.data(), first)){
+                std::fill(this->work.begin(), this->work.end(), 0.0);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool EigenCholesky::LDLT::update(double* w, std::ptrdiff_t k, const double* sigma, std::ptrdiff_t first){
+    const std::ptrdiff_t* Lp = this->m_matrix.outerIndexPtr();
+    const std::ptrdiff_t* Li = this->m_matrix.innerIndexPtr();
+    double* Lx = this->m_matrix.valuePtr();
+    double* D = this->m_diag.data();
+    // Method C1 of Gill, Golub, Murray and Saunders, column by column:
+    // the rows of column j of L are all ancestors of j, so only the path
+    // from first to the root is changed
+    std::vector<double> alpha(sigma, sigma + k);
+    std::vector<double> beta(k);
+    std::vector<double> p(k);
+    for(std::ptrdiff_t j = first; j > -1; j = this->m_parent[j]){
+        double* wj = w + j*k;
+        bool any = false;
+        for(std::ptrdiff_t c = 0; c < k; ++c){
+            p[c] = wj[c];
+            wj[c] = 0;
+            if(p[c] == 0){
+                beta[c] = 0;
+                continue;
+            }
+            any = true;
+            const double d = D[j];
+            const double d_new = d + alpha[c]*p[c]*p[c];
+            if(!(d_new > 0)){
+                return false;
+            }
+            beta[c] = p[c]*alpha[c]/d_new;
+            alpha[c] *= d/d_new;
+            D[j] = d_new;
+        }
+        if(!any){
+            continue;
+        }
+        // Each term sees the column as left by the previous ones
+        for(std::ptrdiff_t q = Lp[j]; q < Lp[j+1]; ++q){
+            double* wr = w + Li[q]*k;
+            double l = Lx[q];
+            for(std::ptrdiff_t c = 0; c < k; ++c){
+                wr[c] -= p[c]*l;
+                l += beta[c]*wr[c];
+            }
+            Lx[q] = l;
+        }
+    }
+    return true;
+}
+
+double EigenCholesky::LDLT::update_cost(std::ptrdiff_t first) const{
+    const std::ptrdiff_t* Lp = this->m_matrix.outerIndexPtr();
+    double cost = 0;
+    for(std::ptrdiff_t j = first; j > -1; j = this->m_parent[j]){
+        cost += 4*(Lp[j+1] - Lp[j]) + 6;
+    }
+    return cost;
+}
+
+double EigenCholesky::LDLT::factor_cost() const{
+    const std::ptrdiff_t* Lp = this->m_matrix.outerIndexPtr();
+    const std::ptrdiff_t n = this->m_matrix.cols();
+    double cost = 0;
+    for(std::ptrdiff_t j = 0; j < n; ++j){
+        const double c = Lp[j+1] - Lp[j];
+        cost += c*(c + 3);
+    }
+    return cost;
 }
 
 void EigenCholesky::compute(){
-    this->solver.compute(this->K);
+    Timer timer;
+    if(!this->modifications.empty()){
+        const bool updated = !this->first_time && this->worth_updating() && this->update_factor();
+        this->modifications.clear();
+        this->pending_rank = 0;
+        if(updated){
+            if(this->scheduled){
+                this->schedule.update(this->solver.matrixL().nestedExpression());
+            }
+            this->timings.update += timer.elapsed();
+            ++this->timings.update_calls;
+            this->update_condition();
+            return;
+        }
+    }
+    if(this->first_time){
+        this->solver.analyzePattern(*this->K_map);
+        this->timings.symbolic += timer.elapsed();
+        ++this->timings.symbolic_calls;
+        this->first_time = false;
+        this->scheduled = false;
+        timer.reset();
+    }
+    this->solver.factorize(*this->K_map);
+    if(this->level_scheduling){
+        const Mat& L = this->solver.matrixL().nestedExpression();
+        if(this->scheduled){
+            this->schedule.update(L);
+        } else {
+            this->schedule.analyze(L);
+            this->scheduled = true;
+        }
+    }
+    this->timings.numeric += timer.elapsed();
+    ++this->timings.numeric_calls;
+    this->update_condition();
+}
+
+void EigenCholesky::update_condition(){
+    if(!this->estimate_condition){
+        return;
+    }
+    SparseOperator A;
+    A.set_matrix(*this->K_map);
+    this->condition = hager_condition(A, [this](const Eigen::VectorXd& b, Eigen::VectorXd& x){
+        this->solve(x, b);
+    });
+    print_line("Cholesky: " + this->condition.to_string());
 }
 
 void EigenCholesky::solve(std::vector<double>& x, std::vector<double>& b){
+    Timer timer;
+    const std::ptrdiff_t n = this->K_map->rows();
+    // Solved straight into x
+    Eigen::Map<Eigen::VectorXd> u(x.data(), n);
+    if(this->scheduled){
+        Eigen::VectorXd y = this->solver.permutationP()*Eigen::Map<const Eigen::VectorXd>(b.data(), n);
+        this->solve_scheduled(y.data(), 1);
+        u = this->solver.permutationPinv()*y;
+    } else {
+        u = this->solver.solve(Eigen::Map<const Eigen::VectorXd>(b.data(), n));
+    }
+
+    this->timings.solve += timer.elapsed();
+    ++this->timings.solve_calls;
+}
+
+void EigenCholesky::solve(Eigen::VectorXd& x, const Eigen::VectorXd& b) const{
+    if(this->scheduled){
+        Eigen::VectorXd y = this->solver.permutationP()*b;
+        this->solve_scheduled(y.data(), 1);
+        x = this->solver.permutationPinv()*y;
+    } else {
+        x = this->solver.solve(b);
+    }
+}
+
+void EigenCholesky::solve(Eigen::MatrixXd& X, const Eigen::MatrixXd& B) const{
+    // Row-major, so that each entry of L updates every right-hand side
+    // with one contiguous axpy
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMat;
+    if(this->scheduled){
+        RowMat Y = this->solver.permutationP()*B;
+        this->solve_scheduled(Y.data(), Y.cols());
+        X = this->solver.permutationPinv()*Y;
+        return;
+    }
+    if(B.cols() < 4){
+        // Too few columns for the row updates to pay off
+        X = this->solver.solve(B);
+        return;
+    }
+    const Mat& L = this->solver.matrixL().nestedExpression();
+    const Eigen::VectorXd& D = this->solver.vectorD();
+    const std::ptrdiff_t n = L.cols();
+
+    RowMat Y = this->solver.permutationP()*B;
+    // L is unit lower triangular
+    for(std::ptrdiff_t j = 0; j < n; ++j){
+        for(Mat::InnerIterator it(L, j); it; ++it){
+            if(it.row() != j){
+                Y.row(it.row()) -= it.value()*Y.row(j);
+            }
+        }
+    }
+    for(std::ptrdiff_t j = 0; j < n; ++j){
+        Y.row(j) /= D[j];
+    }
+    for(std::ptrdiff_t j = n; j-- > 0;){
+        for(Mat::InnerIterator it(L, j); it; ++it){
+            if(it.row() != j){
+                Y.row(j) -= it.value()*Y.row(it.row());
+            }
+        }
+    }
+    X = this->solver.permutationPinv()*Y;
+}
+
+void EigenCholesky::solve_scheduled(double* y, std::ptrdiff_t k) const{
+    const Eigen::VectorXd& D = this->solver.vectorD();
+    const std::ptrdiff_t n = D.size();
+    this->schedule.solve_forward(y, k);
+    #pragma omp parallel for
+    for(std::ptrdiff_t j = 0; j < n; ++j){
+        for(std::ptrdiff_t c = 0; c < k; ++c){
+            y[j*k + c] /= D[j];
+        }
+    }
+    this->schedule.solve_backward(y, k);
+}
+
+void EigenCholesky::print_timings() const{
+    const auto& t = this->timings;
+    print_line("Cholesky: symbolic: " + std::to_string(t.symbolic) + " s (" + std::to_string(t.symbolic_calls) + " calls)");
+    print_line("Cholesky: numeric: " + std::to_string(t.numeric) + " s (" + std::to_string(t.numeric_calls) + " calls)");
+    print_line("Cholesky: solve: " + std::to_string(t.solve) + " s (" + std::to_string(t.solve_calls) + " calls)");
+    print_line("Cholesky: update: " + std::to_string(t.update) + " s (" + std::to_string(t.update_calls) + " calls)");
+}
+
+// MIXED PRECISION
+
+void MixedCholesky::set_K(SparseMatrix& M, size_t L){
+    if(!this->first_time && static_cast<size_t>(this->K.rows()) == L && M.update_eigen_values(this->K)){
+        return;
+    }
+    this->first_time = true;
+    this->K = Mat(L, L);
+    M.to_eigen_sparse(this->K);
+}
+
+void MixedCholesky::set_K(const Mat& K){
+    if(!this->first_time && this->K.rows() == K.rows() && this->K.nonZeros() == K.nonZeros() && K.isCompressed()){
+        if(std::equal(K.outerIndexPtr(), K.outerIndexPtr() + K.outerSize() + 1, this->K.outerIndexPtr()) &&
+           std::equal(K.innerIndexPtr(), K.innerIndexPtr() + K.nonZeros(), this->K.innerIndexPtr())){
+            std::copy(K.valuePtr(), K.valuePtr() + K.nonZeros(), this->K.valuePtr());
+            return;
+        }
+    }
+    this->first_time = true;
+    this->K = K;
+    this->K.makeCompressed();
+}
+
+void MixedCholesky::compute(){
+    if(this->use_double){
+        this->fallback.set_K(this->K);
+        this->fallback.compute();
+        return;
+    }
+
+    // Unit diagonal, so that the float range is not an issue and the
+    // pivots can be compared directly
+    const std::ptrdiff_t N = this->K.cols();
+    this->scale = this->K.diagonal();
+    for(auto& s:this->scale){
+        s = (s > 0) ? 1.0/std::sqrt(s) : 1.0;
+    }
+    if(this->first_time || !this->solver){
+        this->Kf = this->K.cast<float>();
+        this->Kf.makeCompressed();
+    }
+    const auto* outer = this->K.outerIndexPtr();
+    const auto* inner = this->K.innerIndexPtr();
+    const double* values = this->K.valuePtr();
+    float* scaled = this->Kf.valuePtr();
+    #pragma omp parallel for schedule(static)
+    for(std::ptrdiff_t j = 0; j < N; ++j){
+        for(auto p = outer[j]; p < outer[j+1]; ++p){
+            scaled[p] = values[p]*this->scale[inner[p]]*this->scale[j];
+        }
+    }
+
+    if(this->first_time || !this->solver){
+        this->solver.reset(new Eigen::SimplicialLLT<FloatMat, Eigen::Lower, Eigen::AMDOrdering<int>>());
+        this->solver->analyzePattern(this->Kf);
+        this->first_time = false;
+    }
+    this->solver->factorize(this->Kf);
+    if(this->solver->info() != Eigen::Success){
+        this->switch_to_double("non-positive pivot in single precision");
+        return;
+    }
+    // Pivots are relative to the original diagonal. A tiny one means
+    // most of the float digits cancelled out.
+    const auto pivots = this->solver->matrixL().nestedExpression().diagonal();
+    const float min_pivot = pivots.cwiseAbs2().minCoeff();
+    if(min_pivot < 10*std::numeric_limits<float>::epsilon()){
+        this->switch_to_double("pivot ratio " + std::to_string(min_pivot) + " too small for single precision");
+    }
+}
+
+void MixedCholesky::switch_to_double(const std::string& reason){
+    print_line("MixedCholesky: " + reason + ", falling back to double precision.");
+    this->use_double = true;
+    this->solver.reset();
+    this->Kf = FloatMat();
+    this->fallback.set_K(this->K);
+    this->fallback.compute();
+}
+
+void MixedCholesky::solve(std::vector<double>& x, std::vector<double>& b){
     Eigen::VectorXd f = Eigen::Map<Eigen::VectorXd, Eigen::Unaligned>(b.data(), b.size());
+    Eigen::VectorXd u;
 
-    Eigen::VectorXd u = this->solver.solve(f);
+    this->solve(u, f);
 
     std::copy(u.cbegin(), u.cend(), x.begin());
 }
 
+void MixedCholesky::solve(Eigen::VectorXd& x, const Eigen::VectorXd& b){
+    if(!this->use_double){
+        if(this->refine(x, b) || this->cg(x, b)){
+            return;
+        }
+        this->switch_to_double("no convergence in single precision");
+    }
+    this->it = 0;
+    this->fallback.solve(x, b);
+}
+
+void MixedCholesky::apply(const Eigen::VectorXd& r, Eigen::VectorXd& z) const{
+    const Eigen::VectorXf rf = this->scale.cwiseProduct(r).cast<float>();
+    const Eigen::VectorXf zf = this->solver->solve(rf);
+    z = this->scale.cwiseProduct(zf.cast<double>());
+}
+
+double MixedCholesky::backward_error(const Eigen::VectorXd& x, const Eigen::VectorXd& b, const Eigen::VectorXd& r) const{
+    // |K||x| + |b|
+    Eigen::VectorXd den = b.cwiseAbs();
+    const std::ptrdiff_t N = this->K.cols();
+    const auto* outer = this->K.outerIndexPtr();
+    const auto* inner = this->K.innerIndexPtr();
+    const double* values = this->K.valuePtr();
+    for(std::ptrdiff_t j = 0; j < N; ++j){
+        for(auto p = outer[j]; p < outer[j+1]; ++p){
+            const auto i = inner[p];
+            const double v = std::abs(values[p]);
+            den[i] += v*std::abs(x[j]);
+            if(i != j){
+                den[j] += v*std::abs(x[i]);
+            }
+        }
+    }
+    double w = 0;
+    for(std::ptrdiff_t i = 0; i < N; ++i){
+        if(den[i] > 0){
+            w = std::max(w, std::abs(r[i])/den[i]);
+        } else if(r[i] != 0){
+            return std::numeric_limits<double>::infinity();
+        }
+    }
+
+    return w;
+}
+
+bool MixedCholesky::refine(Eigen::VectorXd& x, const Eigen::VectorXd& b){
+    const size_t MAX_STEPS = 20;
+
+    x.setZero(b.size());
+    this->it = 0;
+    if(b.isZero(0)){
+        return true;
+    }
+    Eigen::VectorXd r = b;
+    Eigen::VectorXd d;
+    double last = std::numeric_limits<double>::infinity();
+    for(size_t k = 0; k < MAX_STEPS; ++k){
+        ++this->it;
+        this->apply(r, d);
+        x += d;
+        r = b - this->K.selfadjointView<Eigen::Lower>()*x;
+        const double w = this->backward_error(x, b, r);
+        if(w < this->tol){
+            return true;
+        }
+        // Too slow, leave it to CG
+        if(!(w < 0.5*last)){
+            if(!(w < last)){
+                x -= d;
+            }
+            return false;
+        }
+        last = w;
+    }
+
+    return false;
+}
+
+bool MixedCholesky::cg(Eigen::VectorXd& x, const Eigen::VectorXd& b){
+    const size_t MAX_IT = 200;
+
+    const auto A = this->K.selfadjointView<Eigen::Lower>();
+    Eigen::VectorXd r = b - A*x;
+    Eigen::VectorXd z, q;
+    this->apply(r, z);
+    Eigen::VectorXd p = z;
+    double rz = r.dot(z);
+    for(size_t k = 0; k < MAX_IT; ++k){
+        ++this->it;
+        q.noalias() = A*p;
+        const double alpha = rz/p.dot(q);
+        x += alpha*p;
+        r -= alpha*q;
+        if(k % 10 == 9 || this->backward_error(x, b, r) < this->tol){
+            // Recompute, the recurrence drifts
+            r = b - A*x;
+            if(this->backward_error(x, b, r) < this->tol){
+                return true;
+            }
+        }
+        this->apply(r, z);
+        const double rz_new = r.dot(z);
+        p = z + (rz_new/rz)*p;
+        rz = rz_new;
+    }
+
+    return false;
+}
+
 }
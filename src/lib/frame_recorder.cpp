@@ -0,0 +1,157 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include "lib/frame_recorder.hpp"
+#include "lib/image_writer.hpp"
+#include "lib/print.hpp"
+
+namespace dplib{
+
+FrameRecorder::FrameRecorder(size_t W, size_t H, std::string filename, size_t capacity):
+    W(W), H(H), filename(std::move(filename)), capacity(std::max<size_t>(capacity, 1)), n(W*H){
+
+    const std::string& f = this->filename;
+    this->y4m = f.size() >= 4 && f.compare(f.size() - 4, 4, ".y4m") == 0;
+}
+
+FrameRecorder::~FrameRecorder(){
+    this->close();
+}
+
+void FrameRecorder::set_field(size_t n, Field field){
+    if(this->writer.joinable()){
+        print_line("ERROR: FrameRecorder field set after the first frame.");
+        exit(EXIT_FAILURE);
+    }
+    this->n = n;
+    this->field = std::move(field);
+}
+
+bool FrameRecorder::record(const double* values){
+    if(this->calls++ % this->interval != 0){
+        return false;
+    }
+    if(!this->writer.joinable()){
+        if(this->closing.load(std::memory_order_relaxed)){
+            return false;
+        }
+        this->slots.assign(this->capacity, std::vector<double>(this->n));
+        this->writer = std::thread(&FrameRecorder::run, this);
+    }
+    const size_t h = this->head.load(std::memory_order_relaxed);
+    if(h - this->tail.load(std::memory_order_acquire) == this->capacity){
+        this->drops.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    std::copy(values, values + this->n, this->slots[h % this->capacity].begin());
+    this->head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+void FrameRecorder::close(){
+    this->closing.store(true, std::memory_order_release);
+    if(this->writer.joinable()){
+        this->writer.join();
+    }
+}
+
+void FrameRecorder::run(){
+    if(this->y4m){
+        this->stream.open(this->filename, std::ios::binary);
+        // Full range 4:2:0, so that gray levels are written as they are
+        this->stream << "YUV4MPEG2 W" << W << " H" << H << " F" << this->fps << ":1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n";
+        if(!this->stream){
+            print_line("ERROR: could not open " + this->filename + ".");
+        }
+    }
+    while(true){
+        const size_t t = this->tail.load(std::memory_order_relaxed);
+        if(t == this->head.load(std::memory_order_acquire)){
+            // The recording thread is done once closing is set, so an
+            // empty buffer after seeing it stays empty
+            if(this->closing.load(std::memory_order_acquire) && t == this->head.load(std::memory_order_acquire)){
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        if(this->field){
+            this->write_frame(this->field(this->slots[t % this->capacity].data()), t);
+        } else {
+            this->write_frame(this->slots[t % this->capacity], t);
+        }
+        this->tail.store(t + 1, std::memory_order_release);
+    }
+    if(this->y4m){
+        this->stream.close();
+    }
+}
+
+void FrameRecorder::write_frame(const std::vector<double>& values, size_t frame){
+    double min_x = this->min;
+    double max_x = this->max;
+    if(!this->fixed_range){
+        min_x = *std::min_element(values.begin(), values.begin() + W*H);
+        max_x = *std::max_element(values.begin(), values.begin() + W*H);
+    }
+    const double scale = (max_x > min_x) ? 255.0/(max_x - min_x) : 0;
+    const auto gray = [&](double x){
+        // Dark for high values, as in Window
+        return static_cast<std::uint8_t>(std::min(std::max((max_x - x)*scale, 0.0), 255.0));
+    };
+
+    if(this->y4m){
+        const size_t chroma = ((W+1)/2)*((H+1)/2);
+        this->pixels.resize(W*H + 2*chroma);
+        for(size_t i = 0; i < W*H; ++i){
+            this->pixels[i] = gray(values[i]);
+        }
+        std::fill(this->pixels.begin() + W*H, this->pixels.end(), 128);
+        this->stream << "FRAME\n";
+        this->stream.write(reinterpret_cast<const char*>(this->pixels.data()), this->pixels.size());
+        return;
+    }
+
+    this->pixels.resize(W*H*4);
+    for(size_t i = 0; i < W*H; ++i){
+        const std::uint8_t g = gray(values[i]);
+        this->pixels[i*4+0] = g;
+        this->pixels[i*4+1] = g;
+        this->pixels[i*4+2] = g;
+        this->pixels[i*4+3] = 255;
+    }
+    const size_t dot = this->filename.find_last_of('.');
+    const std::string base = (dot == std::string::npos) ? this->filename : this->filename.substr(0, dot);
+    const std::string ext = (dot == std::string::npos) ? ".png" : this->filename.substr(dot);
+    char number[32];
+    std::snprintf(number, sizeof(number), "_%06zu", frame);
+    if(!ImageWriter::save(base + number + ext, W, H, this->pixels)){
+        print_line("ERROR: could not write frame " + base + number + ext + ".");
+    }
+}
+
+}
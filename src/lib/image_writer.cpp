@@ -0,0 +1,105 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <fstream>
+#include <utility>
+#include <SFML/Graphics/Image.hpp>
+#include "lib/image_writer.hpp"
+#include "lib/print.hpp"
+
+namespace dplib{
+
+ImageWriter::~ImageWriter(){
+    if(!this->thread.joinable()){
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stop = true;
+    }
+    this->queued.notify_one();
+    this->thread.join();
+}
+
+void ImageWriter::write(std::string filename, size_t width, size_t height, std::vector<std::uint8_t> rgba){
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->queue.push_back({std::move(filename), width, height, std::move(rgba)});
+        if(!this->thread.joinable()){
+            this->thread = std::thread(&ImageWriter::run, this);
+        }
+    }
+    this->queued.notify_one();
+}
+
+void ImageWriter::wait(){
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->written.wait(lock, [this]{ return this->queue.empty() && !this->busy; });
+}
+
+void ImageWriter::run(){
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while(true){
+        this->queued.wait(lock, [this]{ return this->stop || !this->queue.empty(); });
+        if(this->queue.empty()){
+            // Stopped, with nothing left to write
+            return;
+        }
+        Image img = std::move(this->queue.front());
+        this->queue.pop_front();
+        this->busy = true;
+        lock.unlock();
+
+        if(!save(img.filename, img.width, img.height, img.rgba)){
+            print_line("ERROR: could not write image " + img.filename + ".");
+        }
+
+        lock.lock();
+        this->busy = false;
+        this->written.notify_all();
+    }
+}
+
+bool ImageWriter::save(const std::string& filename, size_t width, size_t height, const std::vector<std::uint8_t>& rgba){
+    const bool ppm = filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".ppm") == 0;
+    if(!ppm){
+        sf::Image image;
+        image.create(width, height, rgba.data());
+        return image.saveToFile(filename);
+    }
+
+    std::ofstream file(filename, std::ios::binary);
+    file << "P6\n" << width << " " << height << "\n255\n";
+    // Drops the alpha channel, one row at a time
+    std::vector<char> row(width*3);
+    for(size_t y = 0; y < height; ++y){
+        const std::uint8_t* p = rgba.data() + y*width*4;
+        for(size_t x = 0; x < width; ++x){
+            row[x*3+0] = p[x*4+0];
+            row[x*3+1] = p[x*4+1];
+            row[x*3+2] = p[x*4+2];
+        }
+        file.write(row.data(), row.size());
+    }
+    return static_cast<bool>(file);
+}
+
+}
@@ -0,0 +1,192 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "lib/level_schedule.hpp"
+#include <algorithm>
+#include <string>
+#include "lib/print.hpp"
+
+namespace dplib{
+
+void LevelSchedule::analyze(const Mat& L){
+    const std::ptrdiff_t n = L.cols();
+    const auto* outer = L.outerIndexPtr();
+    const auto* inner = L.innerIndexPtr();
+    const auto* nnz = L.innerNonZeroPtr();
+    auto end = [&](std::ptrdiff_t j){
+        return (nnz != nullptr) ? outer[j] + nnz[j] : outer[j+1];
+    };
+
+    // Rows of L without the diagonal, as positions in L. Going through the
+    // columns in order keeps each row sorted.
+    std::vector<std::ptrdiff_t> row_ptr(n+1, 0);
+    for(std::ptrdiff_t j = 0; j < n; ++j){
+        for(auto p = outer[j]; p < end(j); ++p){
+            if(inner[p] != j){
+                ++row_ptr[inner[p] + 1];
+            }
+        }
+    }
+    for(std::ptrdiff_t i = 0; i < n; ++i){
+        row_ptr[i+1] += row_ptr[i];
+    }
+    std::vector<std::ptrdiff_t> row_entries(row_ptr[n]);
+    std::vector<std::ptrdiff_t> row_cols(row_ptr[n]);
+    std::vector<std::ptrdiff_t> next(row_ptr.begin(), row_ptr.end() - 1);
+    // A row is one level past the latest row it depends on
+    std::vector<std::ptrdiff_t> level(n, 0);
+    for(std::ptrdiff_t j = 0; j < n; ++j){
+        for(auto p = outer[j]; p < end(j); ++p){
+            const std::ptrdiff_t i = inner[p];
+            if(i != j){
+                row_cols[next[i]] = j;
+                row_entries[next[i]++] = p;
+                level[i] = std::max(level[i], level[j] + 1);
+            }
+        }
+    }
+    LevelSchedule::group(level, this->forward.rows, this->forward.begin, this->forward.width);
+    this->forward.gather(n, row_ptr.data(), row_entries.data(), row_cols.data());
+
+    // Same for the columns, from the bottom up
+    std::fill(level.begin(), level.end(), 0);
+    std::vector<std::ptrdiff_t> col_ptr(n+1, 0);
+    for(std::ptrdiff_t j = n; j-- > 0;){
+        for(auto p = outer[j]; p < end(j); ++p){
+            if(inner[p] != j){
+                level[j] = std::max(level[j], level[inner[p]] + 1);
+                ++col_ptr[j+1];
+            }
+        }
+    }
+    for(std::ptrdiff_t j = 0; j < n; ++j){
+        col_ptr[j+1] += col_ptr[j];
+    }
+    std::vector<std::ptrdiff_t> col_entries;
+    std::vector<std::ptrdiff_t> col_rows;
+    col_entries.reserve(col_ptr[n]);
+    col_rows.reserve(col_ptr[n]);
+    for(std::ptrdiff_t j = 0; j < n; ++j){
+        for(auto p = outer[j]; p < end(j); ++p){
+            if(inner[p] != j){
+                col_entries.push_back(p);
+                col_rows.push_back(inner[p]);
+            }
+        }
+    }
+    LevelSchedule::group(level, this->backward.rows, this->backward.begin, this->backward.width);
+    this->backward.gather(n, col_ptr.data(), col_entries.data(), col_rows.data());
+
+    this->update(L);
+}
+
+void LevelSchedule::update(const Mat& L){
+    const double* v = L.valuePtr();
+    for(auto* s:{&this->forward, &this->backward}){
+        const std::ptrdiff_t N = s->source.size();
+        s->val.resize(N);
+        #pragma omp parallel for
+        for(std::ptrdiff_t p = 0; p < N; ++p){
+            s->val[p] = v[s->source[p]];
+        }
+    }
+}
+
+void LevelSchedule::Sweep::gather(std::ptrdiff_t n, const std::ptrdiff_t* ptr, const std::ptrdiff_t* entries, const std::ptrdiff_t* index){
+    // Entries stored in the order the rows are visited, so that each level
+    // reads a contiguous part of the arrays
+    this->ptr.assign(n+1, 0);
+    for(std::ptrdiff_t q = 0; q < n; ++q){
+        const std::ptrdiff_t i = this->rows[q];
+        this->ptr[q+1] = this->ptr[q] + ptr[i+1] - ptr[i];
+    }
+    this->index.resize(this->ptr[n]);
+    this->source.resize(this->ptr[n]);
+    #pragma omp parallel for
+    for(std::ptrdiff_t q = 0; q < n; ++q){
+        const std::ptrdiff_t i = this->rows[q];
+        std::ptrdiff_t r = this->ptr[q];
+        for(auto p = ptr[i]; p < ptr[i+1]; ++p, ++r){
+            this->source[r] = entries[p];
+            this->index[r] = index[p];
+        }
+    }
+}
+
+void LevelSchedule::group(const std::vector<std::ptrdiff_t>& level, std::vector<std::ptrdiff_t>& rows, std::vector<std::ptrdiff_t>& begin, std::vector<std::ptrdiff_t>& width){
+    const std::ptrdiff_t n = level.size();
+    const std::ptrdiff_t levels = (n > 0) ? *std::max_element(level.begin(), level.end()) + 1 : 0;
+    width.assign(levels, 0);
+    for(const auto l:level){
+        ++width[l];
+    }
+    begin.assign(levels+1, 0);
+    for(std::ptrdiff_t l = 0; l < levels; ++l){
+        begin[l+1] = begin[l] + width[l];
+    }
+    // Ascending within each level, for locality
+    rows.resize(n);
+    std::vector<std::ptrdiff_t> next(begin.begin(), begin.end() - 1);
+    for(std::ptrdiff_t i = 0; i < n; ++i){
+        rows[next[level[i]]++] = i;
+    }
+}
+
+void LevelSchedule::Sweep::solve(double* y, std::ptrdiff_t k) const{
+    const std::ptrdiff_t levels = this->width.size();
+    #pragma omp parallel
+    for(std::ptrdiff_t l = 0; l < levels; ++l){
+        #pragma omp for schedule(static)
+        for(auto q = this->begin[l]; q < this->begin[l+1]; ++q){
+            const std::ptrdiff_t i = this->rows[q];
+            if(k == 1){
+                double sum = 0;
+                for(auto p = this->ptr[q]; p < this->ptr[q+1]; ++p){
+                    sum += this->val[p]*y[this->index[p]];
+                }
+                y[i] -= sum;
+                continue;
+            }
+            Eigen::Map<Eigen::RowVectorXd> yi(y + i*k, k);
+            for(auto p = this->ptr[q]; p < this->ptr[q+1]; ++p){
+                yi -= this->val[p]*Eigen::Map<const Eigen::RowVectorXd>(y + this->index[p]*k, k);
+            }
+        }
+    }
+}
+
+void LevelSchedule::print_statistics() const{
+    auto print = [](const std::string& name, const std::vector<std::ptrdiff_t>& width){
+        if(width.empty()){
+            return;
+        }
+        const auto minmax = std::minmax_element(width.begin(), width.end());
+        std::ptrdiff_t total = 0;
+        for(const auto w:width){
+            total += w;
+        }
+        print_line("Levels: " + name + ": " + std::to_string(width.size()) + " levels, rows per level: min " + std::to_string(*minmax.first) + ", average " + std::to_string(static_cast<double>(total)/width.size()) + ", max " + std::to_string(*minmax.second));
+    };
+    print("forward", this->forward.width);
+    print("backward", this->backward.width);
+}
+
+}
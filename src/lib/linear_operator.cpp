@@ -0,0 +1,64 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "lib/linear_operator.hpp"
+
+namespace dplib{
+
+void SparseOperator::set_matrix(const Mat& K){
+    this->set_matrix(MatMap(K.rows(), K.cols(), K.nonZeros(), K.outerIndexPtr(), K.innerIndexPtr(), K.valuePtr(), K.innerNonZeroPtr()));
+}
+
+void SparseOperator::set_matrix(const MatMap& K){
+    this->K.emplace(K);
+    this->n = K.rows();
+    if(K.isCompressed()){
+        this->spmv.set_lower(this->n, K.outerIndexPtr(), K.innerIndexPtr(), K.valuePtr());
+    }
+}
+
+void SparseOperator::apply(const Eigen::VectorXd& x, Eigen::VectorXd& y) const{
+    if(this->K && !this->K->isCompressed()){
+        y.noalias() = this->K->selfadjointView<Eigen::Lower>()*x;
+        return;
+    }
+    y.resize(this->n);
+    this->spmv.multiply(x.data(), y.data());
+}
+
+Eigen::VectorXd SparseOperator::diagonal() const{
+    if(!this->K){
+        return Eigen::VectorXd();
+    }
+    // Rows are sorted, so the diagonal is the first entry of its column
+    const auto* outer = this->K->outerIndexPtr();
+    const auto* inner = this->K->innerIndexPtr();
+    const auto* nnz = this->K->innerNonZeroPtr();
+    Eigen::VectorXd d = Eigen::VectorXd::Zero(this->n);
+    for(std::ptrdiff_t j = 0; j < static_cast<std::ptrdiff_t>(this->n); ++j){
+        const auto end = (nnz != nullptr) ? outer[j] + nnz[j] : outer[j+1];
+        if(outer[j] < end && inner[outer[j]] == j){
+            d[j] = this->K->valuePtr()[outer[j]];
+        }
+    }
+    return d;
+}
+
+}
@@ -19,9 +19,10 @@
  */
 
 #include <cblas.h>
+#include <atomic>
 #include <cmath>
-#include <set>
-#include <queue>
+#include <cstdlib>
+#include <limits>
 #include <algorithm>
 #include "lib/mesh.hpp"
 #include "lib/print.hpp"
@@ -29,7 +30,7 @@
 
 namespace dplib{
 
-RectangularMesh::RectangularMesh(size_t W, size_t H, double t, double elem_size):
+RectangularMesh::RectangularMesh(size_t W, size_t H, double t, double elem_size, Ordering ordering):
     W(W), H(H), element_size(elem_size), t(t), element_nodes(W*H*nodes_per_element, 0),
     node_vector_mapping((W+1)*(H+1)*dof_per_node, 0){
     dplib::print_line("Mesh: generating mesh...");
@@ -45,12 +46,28 @@ RectangularMesh::RectangularMesh(size_t W, size_t H, double t, double elem_size)
         }
     }
 
-    dplib::print_line("Mesh: running RCM...");
     this->old_position_mapping.resize((W+1)*(H+1), 0);
-    reverse_cuthill_mckee(element_nodes, old_position_mapping, nodes_per_element, (W+1)*(H+1));
+    if(ordering == Ordering::NESTED_DISSECTION){
+        dplib::print_line("Mesh: running nested dissection...");
+        nested_dissection(element_nodes, old_position_mapping, W, H);
+    } else {
+        dplib::print_line("Mesh: running RCM...");
+        reverse_cuthill_mckee(element_nodes, old_position_mapping, nodes_per_element, (W+1)*(H+1));
+    }
 }
 
 void RectangularMesh::apply_Neumann(double d, Point begin, Point end){
+    this->neumann.push_back(this->neumann_boundary(d, begin, end));
+}
+
+std::vector<double> RectangularMesh::neumann_load(double d, Point begin, Point end) const{
+    std::vector<double> load(this->load.size(), 0);
+    this->add_neumann(this->neumann_boundary(d, begin, end), load);
+
+    return load;
+}
+
+RectangularMesh::NeumannBoundary RectangularMesh::neumann_boundary(double d, Point begin, Point end) const{
     if(begin.x == end.x && begin.x == W+1){
         begin.x -= 1;
         end.x -= 1;
@@ -59,11 +76,15 @@ void RectangularMesh::apply_Neumann(double d, Point begin, Point end){
         begin.y -= 1;
         end.y -= 1;
     }
-    this->neumann.push_back({d, begin, end});
+    return {d, begin, end};
 }
 
 void RectangularMesh::apply_Dirichlet(double d, Point begin, Point end){
     dplib::print_line("Mesh: generating mesh...");
+    // Fixing nodes changes node_vector_mapping, so the pattern and element
+    // slots of K must be rebuilt, even if the number of unknowns ends up
+    // the same
+    this->K.clear();
     long id = this->dirichlet.size() + 1;
     size_t extension = std::max(std::abs(end.x - begin.x), std::abs(end.y - begin.y));
     this->dirichlet.reserve(this->dirichlet.size() + extension);
@@ -87,7 +108,7 @@ void RectangularMesh::apply_Dirichlet(double d, Point begin, Point end){
     }
 }
 
-void RectangularMesh::generate_K(const double K_MIN){
+void RectangularMesh::generate_load(){
     long id = 0;
     for(auto& n:node_vector_mapping){
         if(n > -1){
@@ -97,84 +118,269 @@ void RectangularMesh::generate_K(const double K_MIN){
     }
 
     dplib::print_line("Mesh: generating Neumann vector...");
-    this->load.resize(id, 0);
+    this->load.assign(id, 0);
     this->psi.resize(id, 0);
     for(const auto& n:this->neumann){
-        const Point& begin = n.begin;
-        const Point& end = n.end;
-        const double de = n.d/(begin.distance(end)*this->element_size);
-        bool first = true;
-        bool last = false;
-        for(size_t x = begin.x; x < end.x || (x == begin.x && x == end.x); ++x){
-            if(begin.x != end.x && x + 1 == end.x){
+        this->add_neumann(n, this->load);
+    }
+}
+
+void RectangularMesh::add_neumann(const NeumannBoundary& n, std::vector<double>& load) const{
+    const Point& begin = n.begin;
+    const Point& end = n.end;
+    const double de = n.d/(begin.distance(end)*this->element_size);
+    bool first = true;
+    bool last = false;
+    for(size_t x = begin.x; x < end.x || (x == begin.x && x == end.x); ++x){
+        if(begin.x != end.x && x + 1 == end.x){
+            last = true;
+        }
+        for(size_t y = begin.y; y < end.y || (y == begin.y && y == end.y); ++y){
+            if(begin.y != end.y && y + 1 == end.y){
                 last = true;
             }
-            for(size_t y = begin.y; y < end.y || (y == begin.y && y == end.y); ++y){
-                if(begin.y != end.y && y + 1 == end.y){
-                    last = true;
-                }
-                const size_t n = this->old_position_mapping[y*(W+1) + x];
-                for(size_t i = 0; i < this->dof_per_node; ++i){
-                    const long u1_id = node_vector_mapping[n*dof_per_node+i];
-                    if(u1_id > -1){
-                        if(first || last){
-                            this->load[u1_id] += de*this->element_size/2;
-                        } else {
-                            this->load[u1_id] += de*this->element_size;
-                        }
+            const size_t n = this->old_position_mapping[y*(W+1) + x];
+            for(size_t i = 0; i < this->dof_per_node; ++i){
+                const long u1_id = node_vector_mapping[n*dof_per_node+i];
+                if(u1_id > -1){
+                    if(first || last){
+                        load[u1_id] += de*this->element_size/2;
+                    } else {
+                        load[u1_id] += de*this->element_size;
                     }
                 }
             }
         }
     }
+}
 
-    dplib::print_line("Mesh: generating global matrix and Dirichlet vector...");
+std::vector<double> RectangularMesh::element_matrix() const{
     std::vector<double> A{1.0, 0.0,
                           0.0, 1.0};
-    const auto k = dplib::Q4::get_diffusion_2D(this->t, this->element_size/2, this->element_size/2, A);
+    return dplib::Q4::get_diffusion_2D(this->t, this->element_size/2, this->element_size/2, A);
+}
+
+void RectangularMesh::generate_K(const double K_MIN){
+    this->generate_load();
+
+    // The pattern is dropped by apply_Dirichlet(), so it is only kept
+    // across density updates
+    if(!this->K.has_pattern()){
+        dplib::print_line("Mesh: generating sparsity pattern...");
+        this->K.clear();
+        this->K.generate_pattern(this->element_nodes, this->node_vector_mapping, this->nodes_per_element, this->dof_per_node, this->load.size());
+    } else {
+        this->K.zero();
+    }
+
+    dplib::print_line("Mesh: generating global matrix and Dirichlet vector...");
+    const auto k = this->element_matrix();
+    this->rho.resize(W*H);
+    // 4-color partition of the grid: elements of the same color do not
+    // share nodes, so they can be assembled concurrently without races in
+    // either K or the Dirichlet correction of the load vector.
+    #pragma omp parallel
+    {
     std::vector<double> rho_k(k);
     std::vector<long> u_pos(this->nodes_per_element*this->dof_per_node, 0);
+    for(size_t c = 0; c < 4; ++c){
+        #pragma omp for collapse(2) schedule(static)
+        for(size_t y = c/2; y < H; y += 2){
+            for(size_t x = c%2; x < W; x += 2){
+                const size_t e = (y*W + x);
+                const Point p{static_cast<double>(x), static_cast<double>(y), 0.0};
+                this->element_dofs(e, u_pos);
+                std::copy(k.begin(), k.end(), rho_k.begin());
+                this->rho[e] = this->ring(p, K_MIN);
+                cblas_dscal(rho_k.size(), this->rho[e], rho_k.data(), 1);
+                this->K.insert_element_matrix(e, rho_k);
+                // Add Dirichlet boundary conditions
+                if(x == 0 || x == W-1 || y == 0 || y == H-1){
+                    this->add_dirichlet(u_pos, rho_k);
+                }
+            }
+        }
+    }
+    }
+}
+
+void RectangularMesh::set_densities(const std::vector<size_t>& elements, const std::vector<double>& rho){
+    this->change_densities(elements, rho, [](const std::vector<long>&, const std::vector<double>&){});
+}
+
+void RectangularMesh::change_densities(const std::vector<size_t>& elements, const std::vector<double>& rho, const std::function<void(const std::vector<long>&, const std::vector<double>&)>& changed){
+    if(this->rho.size() != W*H){
+        dplib::print_line("ERROR: element densities can only be changed after generate_K().");
+        exit(EXIT_FAILURE);
+    }
+    const auto k = this->element_matrix();
+    std::vector<double> delta_k(k.size());
+    std::vector<long> u_pos(this->nodes_per_element*this->dof_per_node, 0);
+    for(size_t i = 0; i < elements.size(); ++i){
+        const size_t e = elements[i];
+        const double delta = rho[i] - this->rho[e];
+        if(delta == 0){
+            continue;
+        }
+        this->rho[e] = rho[i];
+        this->element_dofs(e, u_pos);
+        for(size_t j = 0; j < k.size(); ++j){
+            delta_k[j] = delta*k[j];
+        }
+        this->K.insert_element_matrix(e, delta_k);
+        this->add_dirichlet(u_pos, delta_k);
+        changed(u_pos, delta_k);
+    }
+}
+
+void RectangularMesh::element_dofs(size_t e, std::vector<long>& u_pos) const{
+    for(size_t n = 0; n < this->nodes_per_element; ++n){
+        const size_t node_id = this->element_nodes[e*this->nodes_per_element + n];
+        for(size_t i = 0; i < this->dof_per_node; ++i){
+            const size_t dof_id = node_id*this->dof_per_node + i;
+            u_pos[n*this->dof_per_node + i] = this->node_vector_mapping[dof_id];
+        }
+    }
+}
+
+void RectangularMesh::add_dirichlet(const std::vector<long>& u_pos, const std::vector<double>& M){
+    for(size_t i = 0; i < u_pos.size(); ++i){
+        if(u_pos[i] < 0){
+            continue;
+        }
+        for(size_t j = 0; j < u_pos.size(); ++j){
+            if(u_pos[j] < 0){
+                long dirich_id = -(u_pos[j]+1);
+                this->load[u_pos[i]] -= this->dirichlet[dirich_id]*M[i*u_pos.size() + j];
+            }
+        }
+    }
+}
+
+void RectangularMesh::generate_operator(const double K_MIN){
+    this->generate_load();
+
+    dplib::print_line("Mesh: generating matrix-free operator and Dirichlet vector...");
+    std::vector<double> rho(W*H);
     for(size_t y = 0; y < H; ++y){
         for(size_t x = 0; x < W; ++x){
-            const size_t e = (y*W + x);
             const Point p{static_cast<double>(x), static_cast<double>(y), 0.0};
+            rho[y*W + x] = this->ring(p, K_MIN);
+        }
+    }
+    this->stencil = StencilOperator(W, H, this->element_matrix(), std::move(rho), this->grid_dof_map());
+    this->stencil.apply_dirichlet(this->dirichlet, this->load);
+}
+
+void RectangularMesh::solve(){
+    this->solve(this->solver);
+}
+
+void RectangularMesh::solve_matrix_free(EigenPCG& solver){
+    solver.set_K(this->stencil);
+
+    solver.compute();
+    solver.solve(this->psi, this->load);
+}
+
+std::vector<long> RectangularMesh::deflation_groups(size_t bx, size_t by) const{
+    if(this->rho.size() != W*H){
+        dplib::print_line("ERROR: deflation groups can only be computed after generate_K().");
+        exit(EXIT_FAILURE);
+    }
+    const auto bounds = std::minmax_element(this->rho.begin(), this->rho.end());
+    const double threshold = std::sqrt(std::max(*bounds.first, std::numeric_limits<double>::min())*(*bounds.second));
+    const auto heavy = [&](size_t e){
+        return this->rho[e] >= threshold;
+    };
+
+    // Connected regions of heavy elements, elements sharing a node being
+    // neighbours
+    std::vector<long> region(W*H, -1);
+    std::vector<size_t> stack;
+    long regions = 0;
+    for(size_t e0 = 0; e0 < W*H; ++e0){
+        if(!heavy(e0) || region[e0] > -1){
+            continue;
+        }
+        region[e0] = regions;
+        stack.push_back(e0);
+        while(!stack.empty()){
+            const size_t e = stack.back();
+            stack.pop_back();
+            const size_t x = e % W;
+            const size_t y = e / W;
+            for(size_t ny = (y > 0) ? y-1 : 0; ny <= std::min(y+1, H-1); ++ny){
+                for(size_t nx = (x > 0) ? x-1 : 0; nx <= std::min(x+1, W-1); ++nx){
+                    const size_t n = ny*W + nx;
+                    if(heavy(n) && region[n] < 0){
+                        region[n] = regions;
+                        stack.push_back(n);
+                    }
+                }
+            }
+        }
+        ++regions;
+    }
+
+    std::vector<long> id(regions*bx*by, -1);
+    long count = 0;
+    std::vector<long> group(this->load.size(), -1);
+    for(size_t y = 0; y < H; ++y){
+        for(size_t x = 0; x < W; ++x){
+            const size_t e = y*W + x;
+            if(region[e] < 0){
+                continue;
+            }
+            const size_t key = (region[e]*by + y*by/H)*bx + x*bx/W;
+            if(id[key] < 0){
+                id[key] = count++;
+            }
             for(size_t n = 0; n < this->nodes_per_element; ++n){
                 const size_t node_id = this->element_nodes[e*this->nodes_per_element + n];
                 for(size_t i = 0; i < this->dof_per_node; ++i){
-                    const size_t dof_id = node_id*this->dof_per_node + i;
-                    u_pos[n*this->dof_per_node + i] = this->node_vector_mapping[dof_id];
-                }
-            }
-            std::copy(k.begin(), k.end(), rho_k.begin());
-            const double rho = this->ring(p, K_MIN);
-            cblas_dscal(rho_k.size(), rho, rho_k.data(), 1);
-            this->K.insert_matrix_symmetric_mumps(rho_k, u_pos);
-            // Add Dirichlet boundary conditions
-            if(x == 0 || x == W-1 || y == 0 || y == H-1){
-                for(size_t i = 0; i < u_pos.size(); ++i){
-                    if(u_pos[i] < 0){
-                        continue;
-                    }
-                    for(size_t j = 0; j < u_pos.size(); ++j){
-                        if(u_pos[j] < 0){
-                            long dirich_id = -(u_pos[j]+1);
-                            this->load[u_pos[i]] -= this->dirichlet[dirich_id]*rho_k[i*u_pos.size() + j];
-                        }
+                    const long dof = this->node_vector_mapping[node_id*this->dof_per_node + i];
+                    if(dof > -1){
+                        group[dof] = id[key];
                     }
                 }
             }
         }
     }
+    // Nodes shared between groups end up in the last one, which may leave
+    // some groups empty
+    std::vector<long> used(count, -1);
+    count = 0;
+    for(auto& g:group){
+        if(g > -1){
+            if(used[g] < 0){
+                used[g] = count++;
+            }
+            g = used[g];
+        }
+    }
+
+    return group;
 }
 
-void RectangularMesh::solve(){
-    solver.set_K(this->K, this->load.size());
+std::vector<long> RectangularMesh::grid_dof_map() const{
+    std::vector<long> dofs((W+1)*(H+1));
+    for(size_t i = 0; i < dofs.size(); ++i){
+        dofs[i] = this->node_vector_mapping[this->old_position_mapping[i]*this->dof_per_node];
+    }
 
-    solver.compute();
-    solver.solve(this->psi, this->load);
+    return dofs;
 }
     
 std::vector<double> RectangularMesh::get_result(){
+    return this->get_result(this->psi.data());
+}
+
+std::vector<double> RectangularMesh::get_result(const Eigen::MatrixXd& psi, size_t load_case) const{
+    return this->get_result(psi.col(load_case).data());
+}
+
+std::vector<double> RectangularMesh::get_result(const double* psi) const{
     std::vector<double> result(W*H, 0);
 
     for(size_t y = 0; y < H; ++y){
@@ -186,7 +392,7 @@ std::vector<double> RectangularMesh::get_result(){
                     const size_t dof_id = node_id*this->dof_per_node + i;
                     const long pos = this->node_vector_mapping[dof_id];
                     if(pos > -1){
-                        result[e] += this->psi[pos]/4;
+                        result[e] += psi[pos]/4;
                     } else {
                         const long d_pos = -(pos+1);
                         result[e] += this->dirichlet[d_pos]/4;
@@ -213,63 +419,202 @@ double RectangularMesh::ring(const Point& p, double min){
     }
 }
 
-void reverse_cuthill_mckee(std::vector<size_t>& element_nodes, std::vector<size_t>& old_position_mapping, const size_t nodes_per_element, const size_t number_of_nodes){
-    dplib::print_line("Mesh: RCM: creating adjacency matrix...");
-    // Create adjacency "matrix"
-    std::vector<std::set<size_t>> adjacents(number_of_nodes);
+namespace{
+
+// Compressed adjacency of the nodes (no self loops), sorted by index
+void node_adjacency(const std::vector<size_t>& element_nodes, const size_t nodes_per_element, const size_t number_of_nodes, std::vector<size_t>& adj_begin, std::vector<size_t>& adj){
+    const size_t N = number_of_nodes;
     const size_t number_of_elements = element_nodes.size()/nodes_per_element;
+
+    // Every element connection, with duplicates
+    std::vector<size_t> begin(N+1, 0);
+    for(const auto n:element_nodes){
+        begin[n+1] += nodes_per_element - 1;
+    }
+    for(size_t n = 0; n < N; ++n){
+        begin[n+1] += begin[n];
+    }
+    std::vector<size_t> all(begin[N]);
+    std::vector<size_t> next(begin.begin(), begin.end()-1);
     for(size_t e = 0; e < number_of_elements; ++e){
+        const size_t* nodes = element_nodes.data() + e*nodes_per_element;
         for(size_t i = 0; i < nodes_per_element; ++i){
-            for(size_t j = i+1; j < nodes_per_element; ++j){
-                const size_t ni = element_nodes[e*nodes_per_element+i];
-                const size_t nj = element_nodes[e*nodes_per_element+j];
-                adjacents[ni].insert(nj);
-                adjacents[nj].insert(ni);
+            for(size_t j = 0; j < nodes_per_element; ++j){
+                if(i != j){
+                    all[next[nodes[i]]++] = nodes[j];
+                }
             }
         }
     }
-    std::vector<bool> added(number_of_nodes, false);
 
-    // Get node with least degree
-    dplib::print_line("Mesh: RCM: getting node with least degree...");
-    size_t min_degree = adjacents[0].size();
-    size_t min_node = 0;
-    for(size_t i = 1; i < adjacents.size(); ++i){
-        if(adjacents[i].size() < min_degree){
-            min_node = i;
-            min_degree = adjacents[i].size();
-        }
+    adj_begin.assign(N+1, 0);
+    #pragma omp parallel for schedule(static)
+    for(size_t n = 0; n < N; ++n){
+        auto b = all.begin() + begin[n];
+        auto e = all.begin() + begin[n+1];
+        std::sort(b, e);
+        adj_begin[n+1] = std::unique(b, e) - b;
+    }
+    for(size_t n = 0; n < N; ++n){
+        adj_begin[n+1] += adj_begin[n];
     }
+    adj.resize(adj_begin[N]);
+    #pragma omp parallel for schedule(static)
+    for(size_t n = 0; n < N; ++n){
+        std::copy(all.begin() + begin[n], all.begin() + begin[n] + (adj_begin[n+1] - adj_begin[n]), adj.begin() + adj_begin[n]);
+    }
+}
 
-    // Generate Cuthill-McKee
-    dplib::print_line("Mesh: RCM: reorganizing nodes...");
+const size_t NO_OWNER = std::numeric_limits<size_t>::max();
+
+// Level-synchronous Cuthill-McKee breadth-first search from `start`,
+// appending the nodes to `order`. Gives the same order as the sequential
+// queue version: each node of a level is claimed by the first node of the
+// previous level adjacent to it, and the nodes claimed by the same node
+// are sorted by degree (then index). `owner` must be all NO_OWNER, and is
+// left that way. Returns the position of the last level in `order`.
+size_t cuthill_mckee(const size_t start, const std::vector<size_t>& adj_begin, const std::vector<size_t>& adj, std::vector<char>& visited, std::vector<std::atomic<size_t>>& owner, std::vector<size_t>& order, size_t& levels){
+    auto degree = [&](size_t n){
+        return adj_begin[n+1] - adj_begin[n];
+    };
     auto comp = [&](size_t n1, size_t n2){
-        return adjacents[n1].size() < adjacents[n2].size();
+        return degree(n1) < degree(n2) || (degree(n1) == degree(n2) && n1 < n2);
+    };
+
+    size_t level_begin = order.size();
+    order.push_back(start);
+    visited[start] = 1;
+    levels = 1;
+    std::vector<size_t> count;
+    while(true){
+        const size_t level_end = order.size();
+        const size_t F = level_end - level_begin;
+
+        #pragma omp parallel for schedule(static)
+        for(size_t i = 0; i < F; ++i){
+            const size_t u = order[level_begin + i];
+            for(size_t p = adj_begin[u]; p < adj_begin[u+1]; ++p){
+                const size_t v = adj[p];
+                if(!visited[v]){
+                    size_t cur = owner[v].load(std::memory_order_relaxed);
+                    while(i < cur && !owner[v].compare_exchange_weak(cur, i, std::memory_order_relaxed));
+                }
+            }
+        }
+
+        count.assign(F+1, 0);
+        #pragma omp parallel for schedule(static)
+        for(size_t i = 0; i < F; ++i){
+            const size_t u = order[level_begin + i];
+            for(size_t p = adj_begin[u]; p < adj_begin[u+1]; ++p){
+                const size_t v = adj[p];
+                if(!visited[v] && owner[v].load(std::memory_order_relaxed) == i){
+                    ++count[i+1];
+                }
+            }
+        }
+        for(size_t i = 0; i < F; ++i){
+            count[i+1] += count[i];
+        }
+        if(count[F] == 0){
+            break;
+        }
+
+        order.resize(level_end + count[F]);
+        #pragma omp parallel for schedule(static)
+        for(size_t i = 0; i < F; ++i){
+            const size_t u = order[level_begin + i];
+            const auto b = order.begin() + level_end + count[i];
+            auto e = b;
+            for(size_t p = adj_begin[u]; p < adj_begin[u+1]; ++p){
+                const size_t v = adj[p];
+                if(!visited[v] && owner[v].load(std::memory_order_relaxed) == i){
+                    *e = v;
+                    ++e;
+                }
+            }
+            std::sort(b, e, comp);
+        }
+
+        #pragma omp parallel for schedule(static)
+        for(size_t k = level_end; k < order.size(); ++k){
+            visited[order[k]] = 1;
+            owner[order[k]].store(NO_OWNER, std::memory_order_relaxed);
+        }
+        level_begin = level_end;
+        ++levels;
+    }
+
+    return level_begin;
+}
+
+// George-Liu pseudo-peripheral node of the component containing `start`.
+// `order` receives the Cuthill-McKee order of the component starting from
+// that node.
+size_t pseudo_peripheral_node(size_t start, const std::vector<size_t>& adj_begin, const std::vector<size_t>& adj, const std::vector<char>& visited, std::vector<std::atomic<size_t>>& owner, std::vector<size_t>& order){
+    auto degree = [&](size_t n){
+        return adj_begin[n+1] - adj_begin[n];
     };
-    std::queue<size_t> queue;
-    queue.push(min_node);
-    added[min_node] = true;
+
+    std::vector<char> scratch(visited);
+    order.clear();
+    size_t eccentricity = 0;
+    size_t last = cuthill_mckee(start, adj_begin, adj, scratch, owner, order, eccentricity);
+    std::vector<size_t> candidate;
+    while(true){
+        size_t x = order[last];
+        for(size_t k = last; k < order.size(); ++k){
+            if(degree(order[k]) < degree(x)){
+                x = order[k];
+            }
+        }
+        std::copy(visited.begin(), visited.end(), scratch.begin());
+        candidate.clear();
+        size_t e = 0;
+        const size_t candidate_last = cuthill_mckee(x, adj_begin, adj, scratch, owner, candidate, e);
+        if(e <= eccentricity){
+            break;
+        }
+        start = x;
+        eccentricity = e;
+        last = candidate_last;
+        order.swap(candidate);
+    }
+
+    return start;
+}
+
+}
+
+void reverse_cuthill_mckee(std::vector<size_t>& element_nodes, std::vector<size_t>& old_position_mapping, const size_t nodes_per_element, const size_t number_of_nodes){
+    dplib::print_line("Mesh: RCM: creating adjacency matrix...");
+    std::vector<size_t> adj_begin, adj;
+    node_adjacency(element_nodes, nodes_per_element, number_of_nodes, adj_begin, adj);
+
+    // Generate Cuthill-McKee, one connected component at a time, each
+    // starting from a pseudo-peripheral node
+    dplib::print_line("Mesh: RCM: reorganizing nodes...");
+    std::vector<char> visited(number_of_nodes, 0);
+    std::vector<std::atomic<size_t>> owner(number_of_nodes);
+    for(auto& o:owner){
+        o.store(NO_OWNER, std::memory_order_relaxed);
+    }
     std::vector<size_t> result;
     result.reserve(number_of_nodes);
-    while(!queue.empty()){
-        size_t node = queue.front();
-        auto& adj = adjacents[node];
-
-        std::vector<size_t> new_nodes;
-        new_nodes.reserve(adj.size());
-        for(auto& n:adj){
-            if(!added[n]){
-                added[n] = true;
-                auto upper = std::upper_bound(new_nodes.begin(), new_nodes.end(), n, comp);
-                new_nodes.insert(upper, n);
+    std::vector<size_t> component;
+    while(result.size() < number_of_nodes){
+        // Unvisited node with least degree
+        size_t min_node = number_of_nodes;
+        for(size_t i = 0; i < number_of_nodes; ++i){
+            if(!visited[i] && (min_node == number_of_nodes || adj_begin[i+1] - adj_begin[i] < adj_begin[min_node+1] - adj_begin[min_node])){
+                min_node = i;
             }
         }
-        for(auto& n:new_nodes){
-            queue.push(n);
+        pseudo_peripheral_node(min_node, adj_begin, adj, visited, owner, component);
+        for(const auto n:component){
+            visited[n] = 1;
         }
-
-        result.push_back(node);
-        queue.pop();
+        result.insert(result.end(), component.begin(), component.end());
     }
 
     // Reorder node list
@@ -286,4 +631,56 @@ void reverse_cuthill_mckee(std::vector<size_t>& element_nodes, std::vector<size_
     }
 }
 
+namespace{
+
+// Numbers the nodes in [x0, x1)x[y0, y1) of a grid with row length `NW`
+void dissect(size_t x0, size_t x1, size_t y0, size_t y1, size_t NW, std::vector<size_t>& new_node_mapping, size_t& pos){
+    const size_t w = x1 - x0;
+    const size_t h = y1 - y0;
+    if(w == 0 || h == 0){
+        return;
+    }
+    if(w*h <= 4 || (w < 3 && h < 3)){
+        for(size_t y = y0; y < y1; ++y){
+            for(size_t x = x0; x < x1; ++x){
+                new_node_mapping[y*NW + x] = pos;
+                ++pos;
+            }
+        }
+        return;
+    }
+    // Q4 elements only couple neighboring nodes, so a single line of
+    // nodes is a separator
+    if(w >= h){
+        const size_t xs = x0 + w/2;
+        dissect(x0, xs, y0, y1, NW, new_node_mapping, pos);
+        dissect(xs+1, x1, y0, y1, NW, new_node_mapping, pos);
+        for(size_t y = y0; y < y1; ++y){
+            new_node_mapping[y*NW + xs] = pos;
+            ++pos;
+        }
+    } else {
+        const size_t ys = y0 + h/2;
+        dissect(x0, x1, y0, ys, NW, new_node_mapping, pos);
+        dissect(x0, x1, ys+1, y1, NW, new_node_mapping, pos);
+        for(size_t x = x0; x < x1; ++x){
+            new_node_mapping[ys*NW + x] = pos;
+            ++pos;
+        }
+    }
+}
+
+}
+
+void nested_dissection(std::vector<size_t>& element_nodes, std::vector<size_t>& old_position_mapping, const size_t W, const size_t H){
+    std::vector<size_t> new_node_mapping((W+1)*(H+1), 0);
+    size_t pos = 0;
+    dissect(0, W+1, 0, H+1, W+1, new_node_mapping, pos);
+
+    std::copy(new_node_mapping.begin(), new_node_mapping.end(), old_position_mapping.begin());
+    for(auto& n:element_nodes){
+        n = new_node_mapping[n];
+    }
+}
+
 }
@@ -0,0 +1,133 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include "lib/multi_shift_cg.hpp"
+#include "lib/print.hpp"
+
+namespace dplib{
+
+void MultiShiftCG::set_K(SparseMatrix& M, size_t L){
+    if(M.is_compressed() && M.matrix_size() == L){
+        // Works on M's arrays directly
+        this->K = Mat();
+        this->sparse_op.set_matrix(M.eigen_map());
+    } else {
+        this->K.resize(L, L);
+        M.to_eigen_sparse(this->K);
+        this->sparse_op.set_matrix(this->K);
+    }
+    this->A = &this->sparse_op;
+}
+
+void MultiShiftCG::set_K(const LinearOperator& A){
+    this->A = &A;
+}
+
+void MultiShiftCG::set_shifts(const std::vector<double>& shifts){
+    this->shifts = shifts;
+}
+
+void MultiShiftCG::solve(Eigen::MatrixXd& X, const Eigen::VectorXd& b){
+    if(this->A == nullptr || this->shifts.empty()){
+        print_line("ERROR: MultiShiftCG needs K and at least one shift before solving.");
+        exit(EXIT_FAILURE);
+    }
+    const std::ptrdiff_t n = b.size();
+    const std::ptrdiff_t S = this->shifts.size();
+    const size_t max_it = (this->max_it > 0) ? this->max_it : 2*n;
+
+    // CG runs on the smallest shift, the others are relative to it
+    const double base = *std::min_element(this->shifts.begin(), this->shifts.end());
+    std::vector<double> delta(S);
+    for(std::ptrdiff_t s = 0; s < S; ++s){
+        delta[s] = this->shifts[s] - base;
+    }
+
+    X.setZero(n, S);
+    this->it = 0;
+    this->errors.assign(S, 0.0);
+    const double b_norm = b.norm();
+    if(b_norm == 0){
+        return;
+    }
+
+    Eigen::VectorXd r = b;
+    Eigen::VectorXd p = b;
+    Eigen::VectorXd q(n);
+    Eigen::MatrixXd P = b.replicate(1, S);
+    // zeta[s] scales the base residual into the residual of shift s,
+    // zeta_old is its value on the previous iteration
+    std::vector<double> zeta(S, 1.0), zeta_old(S, 1.0);
+    std::vector<bool> active(S, true);
+    std::ptrdiff_t running = S;
+    double rr = r.squaredNorm();
+    double alpha_old = 1, beta_old = 0;
+    while(running > 0 && this->it < max_it){
+        this->A->apply(p, q);
+        q += base*p;
+        const double alpha = rr/p.dot(q);
+        for(std::ptrdiff_t s = 0; s < S; ++s){
+            if(!active[s]){
+                continue;
+            }
+            const double zeta_new = zeta[s]*zeta_old[s]*alpha_old/
+                (alpha*beta_old*(zeta_old[s] - zeta[s]) + zeta_old[s]*alpha_old*(1 + delta[s]*alpha));
+            X.col(s) += (alpha*zeta_new/zeta[s])*P.col(s);
+            zeta_old[s] = zeta[s];
+            zeta[s] = zeta_new;
+        }
+        r -= alpha*q;
+        const double rr_new = r.squaredNorm();
+        const double beta = rr_new/rr;
+        const double r_norm = std::sqrt(rr_new);
+        for(std::ptrdiff_t s = 0; s < S; ++s){
+            if(!active[s]){
+                continue;
+            }
+            this->errors[s] = std::abs(zeta[s])*r_norm/b_norm;
+            if(this->errors[s] <= this->tol){
+                active[s] = false;
+                --running;
+                continue;
+            }
+            const double ratio = zeta[s]/zeta_old[s];
+            P.col(s) = zeta[s]*r + (beta*ratio*ratio)*P.col(s);
+        }
+        p = r + beta*p;
+        rr = rr_new;
+        alpha_old = alpha;
+        beta_old = beta;
+        ++this->it;
+    }
+}
+
+void MultiShiftCG::solve(std::vector<std::vector<double>>& x, const std::vector<double>& b){
+    Eigen::MatrixXd X;
+    this->solve(X, Eigen::Map<const Eigen::VectorXd>(b.data(), b.size()));
+    x.resize(X.cols());
+    for(std::ptrdiff_t s = 0; s < X.cols(); ++s){
+        x[s].assign(X.col(s).data(), X.col(s).data() + X.rows());
+    }
+}
+
+}
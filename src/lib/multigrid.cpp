@@ -0,0 +1,544 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <omp.h>
+#include "lib/multigrid.hpp"
+#include "lib/print.hpp"
+
+namespace dplib{
+
+void Multigrid::setup_hierarchy(){
+    for(size_t l = 0; l + 1 < this->levels.size(); ++l){
+        this->galerkin(l);
+    }
+    this->finish_hierarchy();
+}
+
+void Multigrid::galerkin(size_t l){
+    Level& L = this->levels[l];
+    L.A.makeCompressed();
+    const Mat AP = L.A*L.P;
+    this->levels[l+1].A = L.P.transpose()*AP;
+    this->levels[l+1].A.makeCompressed();
+}
+
+void Multigrid::finish_hierarchy(){
+    for(size_t l = 0; l < this->levels.size(); ++l){
+        Level& L = this->levels[l];
+        L.A.makeCompressed();
+        L.inv_diag = L.A.diagonal();
+        for(auto& d:L.inv_diag){
+            d = (d != 0) ? 1.0/d : 1.0;
+        }
+        if(this->smoother == Smoother::CHEBYSHEV && l + 1 < this->levels.size()){
+            L.lambda_max = Multigrid::estimate_lambda_max(L.A, L.inv_diag);
+        }
+    }
+    this->coarse.set_K(this->levels.back().A);
+    this->coarse.compute();
+}
+
+double Multigrid::estimate_lambda_max(const Mat& A, const Eigen::VectorXd& inv_diag){
+    // Power iteration on D^-1*A
+    Eigen::VectorXd v = Eigen::VectorXd::Random(A.rows()).normalized();
+    Eigen::VectorXd w(v.size());
+    double lambda = 0;
+    for(size_t it = 0; it < 15; ++it){
+        Multigrid::product(A, v, w);
+        w = inv_diag.cwiseProduct(w);
+        lambda = w.norm();
+        if(lambda == 0){
+            break;
+        }
+        v = w/lambda;
+    }
+
+    return lambda;
+}
+
+void Multigrid::product(const Mat& A, const Eigen::VectorXd& x, Eigen::VectorXd& y){
+    // A is symmetric, so column i doubles as row i
+    const std::ptrdiff_t N = A.cols();
+    const auto* outer = A.outerIndexPtr();
+    const auto* inner = A.innerIndexPtr();
+    const auto* vals = A.valuePtr();
+    y.resize(N);
+    #pragma omp parallel for schedule(static)
+    for(std::ptrdiff_t i = 0; i < N; ++i){
+        double s = 0;
+        for(auto p = outer[i]; p < outer[i+1]; ++p){
+            s += vals[p]*x[inner[p]];
+        }
+        y[i] = s;
+    }
+}
+
+void Multigrid::apply(const Eigen::VectorXd& r, Eigen::VectorXd& z) const{
+    z.setZero(r.size());
+    this->cycle(0, r, z);
+}
+
+void Multigrid::cycle(size_t l, const Eigen::VectorXd& b, Eigen::VectorXd& x) const{
+    if(l + 1 == this->levels.size()){
+        this->coarse.solve(x, b);
+        return;
+    }
+    const Level& L = this->levels[l];
+    if(this->smoother == Smoother::GAUSS_SEIDEL){
+        for(size_t s = 0; s < this->sweeps; ++s){
+            this->gauss_seidel(L, b, x, true);
+        }
+    } else {
+        this->chebyshev(L, b, x);
+    }
+
+    Eigen::VectorXd r(b.size());
+    Multigrid::product(L.A, x, r);
+    r = b - r;
+    const Eigen::VectorXd bc = L.P.transpose()*r;
+    Eigen::VectorXd xc = Eigen::VectorXd::Zero(bc.size());
+    this->cycle(l+1, bc, xc);
+    x += L.P*xc;
+
+    if(this->smoother == Smoother::GAUSS_SEIDEL){
+        for(size_t s = 0; s < this->sweeps; ++s){
+            this->gauss_seidel(L, b, x, false);
+        }
+    } else {
+        this->chebyshev(L, b, x);
+    }
+}
+
+void Multigrid::gauss_seidel(const Level& L, const Eigen::VectorXd& b, Eigen::VectorXd& x, bool forward) const{
+    // A is symmetric, so column i doubles as row i
+    const std::ptrdiff_t N = L.A.cols();
+    const auto* outer = L.A.outerIndexPtr();
+    const auto* inner = L.A.innerIndexPtr();
+    const auto* vals = L.A.valuePtr();
+    for(std::ptrdiff_t k = 0; k < N; ++k){
+        const std::ptrdiff_t i = forward ? k : N - 1 - k;
+        double s = b[i];
+        for(auto p = outer[i]; p < outer[i+1]; ++p){
+            if(inner[p] != i){
+                s -= vals[p]*x[inner[p]];
+            }
+        }
+        x[i] = s*L.inv_diag[i];
+    }
+}
+
+void Multigrid::chebyshev(const Level& L, const Eigen::VectorXd& b, Eigen::VectorXd& x) const{
+    // Targets the upper part of the spectrum of D^-1*A
+    const double upper = 1.1*L.lambda_max;
+    const double lower = L.lambda_max/30;
+    const double theta = (upper + lower)/2;
+    const double delta = (upper - lower)/2;
+    const double sigma = theta/delta;
+    double rho = 1/sigma;
+
+    Eigen::VectorXd r(b.size());
+    Eigen::VectorXd Ad(b.size());
+    Multigrid::product(L.A, x, r);
+    r = b - r;
+    Eigen::VectorXd d = L.inv_diag.cwiseProduct(r)/theta;
+    for(size_t k = 0; k < this->sweeps; ++k){
+        x += d;
+        Multigrid::product(L.A, d, Ad);
+        r -= Ad;
+        const double rho_new = 1/(2*sigma - rho);
+        d = (rho_new*rho)*d + (2*rho_new/delta)*L.inv_diag.cwiseProduct(r);
+        rho = rho_new;
+    }
+}
+
+void Multigrid::print_hierarchy() const{
+    for(size_t l = 0; l < this->levels.size(); ++l){
+        const auto& A = this->levels[l].A;
+        print_line("Multigrid: level " + std::to_string(l) + ": " + std::to_string(A.rows()) + " DOFs, " + std::to_string(A.nonZeros()) + " nonzeros");
+    }
+}
+
+GeometricMultigrid::GeometricMultigrid(size_t W, size_t H, std::vector<long> dofs){
+    this->grids.push_back({W, H, std::move(dofs)});
+}
+
+void GeometricMultigrid::compute(const LinearOperator& A){
+    const auto* K = A.matrix();
+    if(K == nullptr){
+        print_line("ERROR: geometric multigrid requires an assembled matrix.");
+        exit(EXIT_FAILURE);
+    }
+    if(this->levels.empty()){
+        this->generate_grids();
+    }
+    this->levels[0].A = K->selfadjointView<Eigen::Lower>();
+    this->setup_hierarchy();
+}
+
+namespace{
+
+// Coarse nodes interpolating fine node i on a line of N fine elements.
+// Coarse node c sits on fine node min(2c, N).
+size_t interpolation_1D(size_t i, size_t N, size_t c[2], double w[2]){
+    if(i % 2 == 0){
+        c[0] = i/2;
+        w[0] = 1;
+        return 1;
+    } else if(i == N){
+        c[0] = (N+1)/2;
+        w[0] = 1;
+        return 1;
+    }
+    c[0] = (i-1)/2;
+    c[1] = (i+1)/2;
+    w[0] = 0.5;
+    w[1] = 0.5;
+    return 2;
+}
+
+}
+
+void GeometricMultigrid::generate_grids(){
+    this->grids.resize(1);
+    this->levels.assign(1, Level());
+    auto count = [](const std::vector<long>& dofs){
+        size_t n = 0;
+        for(const auto& d:dofs){
+            if(d > -1){
+                ++n;
+            }
+        }
+        return n;
+    };
+    size_t n = count(this->grids[0].dofs);
+    while(n > this->max_coarse_size && this->grids.back().W > 1 && this->grids.back().H > 1){
+        const Grid& fine = this->grids.back();
+        Grid coarse{(fine.W+1)/2, (fine.H+1)/2, {}};
+        coarse.dofs.resize((coarse.W+1)*(coarse.H+1), -1);
+        long id = 0;
+        for(size_t y = 0; y <= coarse.H; ++y){
+            for(size_t x = 0; x <= coarse.W; ++x){
+                const size_t fx = std::min(2*x, fine.W);
+                const size_t fy = std::min(2*y, fine.H);
+                if(fine.dofs[fx + fy*(fine.W+1)] > -1){
+                    coarse.dofs[x + y*(coarse.W+1)] = id;
+                    ++id;
+                }
+            }
+        }
+
+        std::vector<Eigen::Triplet<double, std::ptrdiff_t>> t;
+        t.reserve(4*n);
+        size_t cx[2], cy[2];
+        double wx[2], wy[2];
+        for(size_t y = 0; y <= fine.H; ++y){
+            const size_t ny = interpolation_1D(y, fine.H, cy, wy);
+            for(size_t x = 0; x <= fine.W; ++x){
+                const long row = fine.dofs[x + y*(fine.W+1)];
+                if(row < 0){
+                    continue;
+                }
+                const size_t nx = interpolation_1D(x, fine.W, cx, wx);
+                for(size_t j = 0; j < ny; ++j){
+                    for(size_t i = 0; i < nx; ++i){
+                        const long col = coarse.dofs[cx[i] + cy[j]*(coarse.W+1)];
+                        if(col > -1){
+                            t.emplace_back(row, col, wx[i]*wy[j]);
+                        }
+                    }
+                }
+            }
+        }
+        Mat& P = this->levels.back().P;
+        P = Mat(n, id);
+        P.setFromTriplets(t.begin(), t.end());
+
+        this->grids.push_back(std::move(coarse));
+        this->levels.emplace_back();
+        n = id;
+    }
+}
+
+void AlgebraicMultigrid::compute(const LinearOperator& A){
+    const auto* K = A.matrix();
+    if(K == nullptr){
+        print_line("ERROR: algebraic multigrid requires an assembled matrix.");
+        exit(EXIT_FAILURE);
+    }
+    const auto* outer = K->outerIndexPtr();
+    const auto* inner = K->innerIndexPtr();
+    const bool reuse = !this->aggregates.empty() &&
+                       this->pattern_outer.size() == static_cast<size_t>(K->outerSize() + 1) &&
+                       this->pattern_inner.size() == static_cast<size_t>(K->nonZeros()) &&
+                       std::equal(this->pattern_outer.begin(), this->pattern_outer.end(), outer) &&
+                       std::equal(this->pattern_inner.begin(), this->pattern_inner.end(), inner);
+    if(!reuse){
+        this->aggregates.clear();
+        this->pattern_outer.assign(outer, outer + K->outerSize() + 1);
+        this->pattern_inner.assign(inner, inner + K->nonZeros());
+    }
+
+    this->levels.assign(1, Level());
+    this->levels[0].A = K->selfadjointView<Eigen::Lower>();
+    this->levels[0].A.makeCompressed();
+    for(size_t l = 0;; ++l){
+        const Mat& Al = this->levels[l].A;
+        if(reuse && l == this->aggregates.size()){
+            break;
+        } else if(!reuse && (static_cast<size_t>(Al.rows()) <= this->max_coarse_size || this->levels.size() >= this->max_levels)){
+            break;
+        }
+        const auto strong = this->strength(Al);
+        long number_of_aggregates = 0;
+        if(reuse){
+            const auto& agg = this->aggregates[l];
+            number_of_aggregates = *std::max_element(agg.begin(), agg.end()) + 1;
+        } else {
+            auto agg = this->aggregate(Al, strong, number_of_aggregates);
+            if(number_of_aggregates == 0 || number_of_aggregates == Al.rows()){
+                break;
+            }
+            this->aggregates.push_back(std::move(agg));
+        }
+        this->levels[l].P = this->smoothed_prolongation(Al, strong, this->aggregates[l], number_of_aggregates);
+        this->levels.emplace_back();
+        this->galerkin(l);
+    }
+    this->finish_hierarchy();
+}
+
+std::vector<char> AlgebraicMultigrid::strength(const Mat& A) const{
+    const std::ptrdiff_t N = A.cols();
+    const auto* outer = A.outerIndexPtr();
+    const auto* inner = A.innerIndexPtr();
+    const auto* vals = A.valuePtr();
+    const Eigen::VectorXd diag = A.diagonal().cwiseAbs();
+    const double theta2 = this->theta*this->theta;
+
+    std::vector<char> strong(A.nonZeros(), 0);
+    #pragma omp parallel for schedule(static)
+    for(std::ptrdiff_t i = 0; i < N; ++i){
+        for(auto p = outer[i]; p < outer[i+1]; ++p){
+            const auto j = inner[p];
+            strong[p] = (j != i) && (vals[p]*vals[p] >= theta2*diag[i]*diag[j]) && vals[p] != 0;
+        }
+    }
+
+    return strong;
+}
+
+std::vector<long> AlgebraicMultigrid::aggregate(const Mat& A, const std::vector<char>& strong, long& number_of_aggregates) const{
+    const std::ptrdiff_t N = A.cols();
+    const auto* outer = A.outerIndexPtr();
+    const auto* inner = A.innerIndexPtr();
+    const auto* vals = A.valuePtr();
+
+    const long UNASSIGNED = -1;
+    const long ISOLATED = -2;
+    std::vector<long> agg(N, UNASSIGNED);
+    #pragma omp parallel for schedule(static)
+    for(std::ptrdiff_t i = 0; i < N; ++i){
+        bool connected = false;
+        for(auto p = outer[i]; p < outer[i+1] && !connected; ++p){
+            connected = strong[p];
+        }
+        if(!connected){
+            agg[i] = ISOLATED;
+        }
+    }
+
+    // Phase 1: DOFs whose strong neighborhoods are still free become roots.
+    // Each block of DOFs is first aggregated on its own, skipping the DOFs
+    // with strong neighbors in other blocks, so no DOF is touched by two
+    // threads. Those are then handled in order, as in a serial pass.
+    const std::ptrdiff_t T = std::max(1, std::min<int>(omp_get_max_threads(), N));
+    std::vector<long> block_count(T+1, 0);
+    auto try_root = [&](std::ptrdiff_t i, std::ptrdiff_t begin, std::ptrdiff_t end, long id) -> bool{
+        bool free = true;
+        for(auto p = outer[i]; p < outer[i+1] && free; ++p){
+            free = !strong[p] || (inner[p] >= begin && inner[p] < end && agg[inner[p]] == UNASSIGNED);
+        }
+        if(!free){
+            return false;
+        }
+        agg[i] = id;
+        for(auto p = outer[i]; p < outer[i+1]; ++p){
+            if(strong[p]){
+                agg[inner[p]] = id;
+            }
+        }
+        return true;
+    };
+    #pragma omp parallel for schedule(static, 1)
+    for(std::ptrdiff_t t = 0; t < T; ++t){
+        const std::ptrdiff_t begin = (N*t)/T;
+        const std::ptrdiff_t end = (N*(t+1))/T;
+        long id = 0;
+        for(std::ptrdiff_t i = begin; i < end; ++i){
+            if(agg[i] == UNASSIGNED && try_root(i, begin, end, id)){
+                ++id;
+            }
+        }
+        block_count[t+1] = id;
+    }
+    for(std::ptrdiff_t t = 0; t < T; ++t){
+        block_count[t+1] += block_count[t];
+    }
+    #pragma omp parallel for schedule(static, 1)
+    for(std::ptrdiff_t t = 0; t < T; ++t){
+        for(std::ptrdiff_t i = (N*t)/T; i < (N*(t+1))/T; ++i){
+            if(agg[i] >= 0){
+                agg[i] += block_count[t];
+            }
+        }
+    }
+    long id = block_count[T];
+    if(T > 1){
+        for(std::ptrdiff_t i = 0; i < N; ++i){
+            if(agg[i] == UNASSIGNED && try_root(i, 0, N, id)){
+                ++id;
+            }
+        }
+    }
+
+    // Phase 2: join the most strongly connected aggregate from phase 1
+    const std::vector<long> phase1(agg);
+    #pragma omp parallel for schedule(static)
+    for(std::ptrdiff_t i = 0; i < N; ++i){
+        if(agg[i] != UNASSIGNED){
+            continue;
+        }
+        double best = 0;
+        for(auto p = outer[i]; p < outer[i+1]; ++p){
+            if(strong[p] && phase1[inner[p]] >= 0 && std::abs(vals[p]) > best){
+                best = std::abs(vals[p]);
+                agg[i] = phase1[inner[p]];
+            }
+        }
+    }
+
+    // Phase 3: whatever is left forms new aggregates with its free
+    // neighbors
+    for(std::ptrdiff_t i = 0; i < N; ++i){
+        if(agg[i] != UNASSIGNED){
+            continue;
+        }
+        agg[i] = id;
+        for(auto p = outer[i]; p < outer[i+1]; ++p){
+            if(strong[p] && agg[inner[p]] == UNASSIGNED){
+                agg[inner[p]] = id;
+            }
+        }
+        ++id;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for(std::ptrdiff_t i = 0; i < N; ++i){
+        if(agg[i] == ISOLATED){
+            agg[i] = -1;
+        }
+    }
+    number_of_aggregates = id;
+
+    return agg;
+}
+
+AlgebraicMultigrid::Mat AlgebraicMultigrid::smoothed_prolongation(const Mat& A, const std::vector<char>& strong, const std::vector<long>& agg, long number_of_aggregates) const{
+    typedef Eigen::SparseMatrix<double, Eigen::RowMajor, std::ptrdiff_t> RowMat;
+
+    const std::ptrdiff_t N = A.cols();
+    const auto* outer = A.outerIndexPtr();
+    const auto* inner = A.innerIndexPtr();
+    const auto* vals = A.valuePtr();
+
+    Eigen::VectorXd inv_diag = A.diagonal();
+    for(auto& d:inv_diag){
+        d = (d != 0) ? 1.0/d : 1.0;
+    }
+    const double omega = 4.0/(3.0*Multigrid::estimate_lambda_max(A, inv_diag));
+
+    // Each row of P has at most as many entries as the column of A, plus
+    // one. Rows are computed independently, then compacted.
+    std::vector<std::ptrdiff_t> count(N+1, 0);
+    std::vector<std::ptrdiff_t> cols(A.nonZeros() + N);
+    std::vector<double> values(A.nonZeros() + N);
+    #pragma omp parallel for schedule(static)
+    for(std::ptrdiff_t i = 0; i < N; ++i){
+        std::ptrdiff_t* c = cols.data() + outer[i] + i;
+        double* v = values.data() + outer[i] + i;
+        std::ptrdiff_t n = 0;
+        auto add = [&](std::ptrdiff_t a, double val){
+            for(std::ptrdiff_t k = 0; k < n; ++k){
+                if(c[k] == a){
+                    v[k] += val;
+                    return;
+                }
+            }
+            c[n] = a;
+            v[n] = val;
+            ++n;
+        };
+
+        double a_ii = 0;
+        double lumped = 0;
+        for(auto p = outer[i]; p < outer[i+1]; ++p){
+            if(inner[p] == i){
+                a_ii = vals[p];
+            } else if(!strong[p]){
+                lumped += vals[p];
+            }
+        }
+        double d_filtered = a_ii + lumped;
+        if(d_filtered <= 1e-12*std::abs(a_ii)){
+            d_filtered = a_ii;
+        }
+        if(agg[i] > -1){
+            add(agg[i], 1 - omega);
+        }
+        if(d_filtered != 0){
+            const double s = omega/d_filtered;
+            for(auto p = outer[i]; p < outer[i+1]; ++p){
+                if(strong[p] && agg[inner[p]] > -1){
+                    add(agg[inner[p]], -s*vals[p]);
+                }
+            }
+        }
+        count[i+1] = n;
+    }
+    for(std::ptrdiff_t i = 0; i < N; ++i){
+        count[i+1] += count[i];
+    }
+
+    RowMat P(N, number_of_aggregates);
+    P.resizeNonZeros(count[N]);
+    std::copy(count.begin(), count.end(), P.outerIndexPtr());
+    #pragma omp parallel for schedule(static)
+    for(std::ptrdiff_t i = 0; i < N; ++i){
+        const auto n = count[i+1] - count[i];
+        std::copy(cols.begin() + outer[i] + i, cols.begin() + outer[i] + i + n, P.innerIndexPtr() + count[i]);
+        std::copy(values.begin() + outer[i] + i, values.begin() + outer[i] + i + n, P.valuePtr() + count[i]);
+    }
+
+    return Mat(P);
+}
+
+}
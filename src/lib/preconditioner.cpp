@@ -0,0 +1,214 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <omp.h>
+#include "lib/preconditioner.hpp"
+#include "lib/print.hpp"
+
+namespace dplib{
+
+void JacobiPreconditioner::compute(const LinearOperator& A){
+    this->inv_diag = A.diagonal();
+    for(auto& d:this->inv_diag){
+        d = (d != 0) ? 1.0/d : 1.0;
+    }
+}
+
+void JacobiPreconditioner::apply(const Eigen::VectorXd& r, Eigen::VectorXd& z) const{
+    z = this->inv_diag.cwiseProduct(r);
+}
+
+namespace{
+
+// Right-looking IC(0) in place on the lower triangle, which must have
+// sorted rows with the diagonal first. Returns false on breakdown.
+bool ic0(LinearOperator::Mat& L){
+    const std::ptrdiff_t N = L.cols();
+    const auto* outer = L.outerIndexPtr();
+    const auto* inner = L.innerIndexPtr();
+    double* val = L.valuePtr();
+    for(std::ptrdiff_t k = 0; k < N; ++k){
+        const double d = val[outer[k]];
+        if(!(d > 0)){
+            return false;
+        }
+        const double l_kk = std::sqrt(d);
+        val[outer[k]] = l_kk;
+        for(auto p = outer[k]+1; p < outer[k+1]; ++p){
+            val[p] /= l_kk;
+        }
+        // Only update entries already in the pattern
+        for(auto p = outer[k]+1; p < outer[k+1]; ++p){
+            const auto j = inner[p];
+            const double l_jk = val[p];
+            auto r = outer[j];
+            for(auto q = p; q < outer[k+1]; ++q){
+                const auto i = inner[q];
+                while(r < outer[j+1] && inner[r] < i){
+                    ++r;
+                }
+                if(r == outer[j+1]){
+                    break;
+                }
+                if(inner[r] == i){
+                    val[r] -= val[q]*l_jk;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+}
+
+void IC0Preconditioner::compute(const LinearOperator& A){
+    const auto* K = A.matrix();
+    if(K == nullptr){
+        print_line("ERROR: IC(0) requires an assembled matrix.");
+        exit(EXIT_FAILURE);
+    }
+    const std::ptrdiff_t N = K->cols();
+    this->scale = A.diagonal();
+    for(auto& s:this->scale){
+        s = (s > 0) ? 1.0/std::sqrt(s) : 1.0;
+    }
+
+    Mat scaled = *K;
+    scaled.makeCompressed();
+    for(std::ptrdiff_t j = 0; j < N; ++j){
+        const auto p = scaled.outerIndexPtr()[j];
+        if(p == scaled.outerIndexPtr()[j+1] || scaled.innerIndexPtr()[p] != j){
+            print_line("ERROR: IC(0) requires the lower triangle with a stored diagonal.");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for(std::ptrdiff_t j = 0; j < N; ++j){
+        for(Mat::InnerIterator it(scaled, j); it; ++it){
+            it.valueRef() *= this->scale[it.row()]*this->scale[j];
+        }
+    }
+
+    const size_t MAX_ATTEMPTS = 30;
+    this->alpha = 0;
+    for(size_t a = 0;; ++a){
+        this->L = scaled;
+        if(this->alpha > 0){
+            for(std::ptrdiff_t j = 0; j < N; ++j){
+                this->L.valuePtr()[this->L.outerIndexPtr()[j]] += this->alpha;
+            }
+        }
+        if(ic0(this->L)){
+            break;
+        }
+        if(a == MAX_ATTEMPTS){
+            print_line("ERROR: IC(0) broke down even with a diagonal shift of " + std::to_string(this->alpha) + ".");
+            exit(EXIT_FAILURE);
+        }
+        this->alpha = std::max(1e-3, 2*this->alpha);
+    }
+}
+
+void IC0Preconditioner::apply(const Eigen::VectorXd& r, Eigen::VectorXd& z) const{
+    z = this->scale.cwiseProduct(r);
+    this->L.triangularView<Eigen::Lower>().solveInPlace(z);
+    this->L.transpose().triangularView<Eigen::Upper>().solveInPlace(z);
+    z = this->scale.cwiseProduct(z);
+}
+
+void ICTPreconditioner::compute(const LinearOperator& A){
+    const auto* K = A.matrix();
+    if(K == nullptr){
+        print_line("ERROR: ICT requires an assembled matrix.");
+        exit(EXIT_FAILURE);
+    }
+    this->K = *K;
+    this->ict.compute(this->K);
+    if(this->ict.info() != Eigen::Success){
+        print_line("ERROR: ICT broke down, try a larger initial shift.");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void ICTPreconditioner::apply(const Eigen::VectorXd& r, Eigen::VectorXd& z) const{
+    z = this->ict.solve(r);
+}
+
+void BlockJacobiPreconditioner::compute(const LinearOperator& A){
+    const auto* K = A.matrix();
+    if(K == nullptr){
+        print_line("ERROR: block Jacobi requires an assembled matrix.");
+        exit(EXIT_FAILURE);
+    }
+    const std::ptrdiff_t N = K->cols();
+    const std::ptrdiff_t nb = std::max<std::ptrdiff_t>(std::min<std::ptrdiff_t>((this->blocks > 0) ? this->blocks : omp_get_max_threads(), N), 1);
+
+    // Same pattern: only the numeric factorizations are redone. The whole
+    // pattern is compared, as the simplicial factorization relies on the
+    // elimination tree of the analyzed blocks.
+    const auto* outer = K->outerIndexPtr();
+    const auto* inner = K->innerIndexPtr();
+    const bool reuse = static_cast<std::ptrdiff_t>(this->factors.size()) == nb && !this->begin.empty() && this->begin.back() == N &&
+                       this->pattern_inner.size() == static_cast<size_t>(K->nonZeros()) &&
+                       std::equal(this->pattern_outer.begin(), this->pattern_outer.end(), outer) &&
+                       std::equal(this->pattern_inner.begin(), this->pattern_inner.end(), inner);
+    if(!reuse){
+        this->begin.resize(nb+1);
+        for(std::ptrdiff_t b = 0; b <= nb; ++b){
+            this->begin[b] = (b*N)/nb;
+        }
+        this->factors.clear();
+        for(std::ptrdiff_t b = 0; b < nb; ++b){
+            this->factors.emplace_back(new Factor());
+        }
+        this->pattern_outer.assign(outer, outer + N + 1);
+        this->pattern_inner.assign(inner, inner + K->nonZeros());
+    }
+
+    bool ok = true;
+    #pragma omp parallel for schedule(dynamic) reduction(&&:ok)
+    for(std::ptrdiff_t b = 0; b < nb; ++b){
+        const auto size = this->begin[b+1] - this->begin[b];
+        const Mat block = K->block(this->begin[b], this->begin[b], size, size);
+        if(!reuse){
+            this->factors[b]->analyzePattern(block);
+        }
+        this->factors[b]->factorize(block);
+        ok = ok && this->factors[b]->info() == Eigen::Success;
+    }
+    if(!ok){
+        print_line("ERROR: block Jacobi: diagonal block is not positive definite.");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void BlockJacobiPreconditioner::apply(const Eigen::VectorXd& r, Eigen::VectorXd& z) const{
+    const std::ptrdiff_t nb = this->factors.size();
+    z.resize(r.size());
+    #pragma omp parallel for schedule(dynamic)
+    for(std::ptrdiff_t b = 0; b < nb; ++b){
+        const auto size = this->begin[b+1] - this->begin[b];
+        z.segment(this->begin[b], size) = this->factors[b]->solve(r.segment(this->begin[b], size));
+    }
+}
+
+}
@@ -0,0 +1,233 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <algorithm>
+#include <cstdlib>
+#include "lib/print.hpp"
+#include "lib/schwarz.hpp"
+
+namespace dplib{
+
+SchwarzPreconditioner::SchwarzPreconditioner(size_t W, size_t H, std::vector<long> dofs):
+    W(W), H(H), dofs(std::move(dofs)){
+
+    if(this->dofs.size() != (W+1)*(H+1)){
+        print_line("ERROR: SchwarzPreconditioner DOF map does not match the grid size.");
+        exit(EXIT_FAILURE);
+    }
+}
+
+std::vector<size_t> SchwarzPreconditioner::split(size_t size, size_t parts){
+    std::vector<size_t> begin(parts+1);
+    for(size_t b = 0; b <= parts; ++b){
+        begin[b] = (b*size)/parts;
+    }
+    return begin;
+}
+
+void SchwarzPreconditioner::setup(std::ptrdiff_t n){
+    const auto bx = this->split(this->W, this->px);
+    const auto by = this->split(this->H, this->py);
+
+    this->subdomains.clear();
+    this->subdomains.reserve(this->px*this->py);
+    this->group.assign(n, -1);
+    std::vector<size_t> box_size(this->px*this->py, 0);
+    for(size_t j = 0; j < this->py; ++j){
+        for(size_t i = 0; i < this->px; ++i){
+            const size_t b = i + j*this->px;
+            // Nodes of the grown box of elements
+            const size_t x0 = bx[i] - std::min(this->overlap, bx[i]);
+            const size_t x1 = std::min(bx[i+1] + this->overlap, this->W);
+            const size_t y0 = by[j] - std::min(this->overlap, by[j]);
+            const size_t y1 = std::min(by[j+1] + this->overlap, this->H);
+            Subdomain s;
+            for(size_t y = y0; y <= y1; ++y){
+                for(size_t x = x0; x <= x1; ++x){
+                    const long d = this->dofs[x + y*(this->W+1)];
+                    if(d > -1){
+                        s.dofs.push_back(d);
+                    }
+                }
+            }
+            // Nodes of the box itself, the last box of each row and column
+            // also taking the nodes on the far side of the grid
+            const size_t xe = (i+1 == this->px) ? this->W + 1 : bx[i+1];
+            const size_t ye = (j+1 == this->py) ? this->H + 1 : by[j+1];
+            for(size_t y = by[j]; y < ye; ++y){
+                for(size_t x = bx[i]; x < xe; ++x){
+                    const long d = this->dofs[x + y*(this->W+1)];
+                    if(d > -1){
+                        this->group[d] = b;
+                        ++box_size[b];
+                    }
+                }
+            }
+            if(!s.dofs.empty()){
+                std::sort(s.dofs.begin(), s.dofs.end());
+                s.factor.reset(new EigenCholesky());
+                this->subdomains.push_back(std::move(s));
+            }
+        }
+    }
+
+    if(!this->groups.empty()){
+        if(static_cast<std::ptrdiff_t>(this->groups.size()) != n){
+            print_line("ERROR: Schwarz coarse groups do not match the size of K.");
+            exit(EXIT_FAILURE);
+        }
+        this->group = this->groups;
+        box_size.clear();
+        for(const auto g:this->group){
+            if(g >= static_cast<long>(box_size.size())){
+                box_size.resize(g+1, 0);
+            }
+            if(g > -1){
+                ++box_size[g];
+            }
+        }
+    }
+
+    // Boxes (or groups) with no DOFs have no coarse vector
+    std::vector<long> coarse_index(box_size.size(), -1);
+    this->m = 0;
+    for(size_t b = 0; b < box_size.size(); ++b){
+        if(box_size[b] > 0){
+            coarse_index[b] = this->m++;
+        }
+    }
+    for(auto& g:this->group){
+        if(g > -1){
+            g = coarse_index[g];
+        }
+    }
+}
+
+void SchwarzPreconditioner::compute(const LinearOperator& A){
+    const auto* K = A.matrix();
+    if(K == nullptr){
+        print_line("ERROR: Schwarz preconditioner requires an assembled matrix.");
+        exit(EXIT_FAILURE);
+    }
+    const std::ptrdiff_t n = K->cols();
+    if(this->subdomains.empty() || static_cast<std::ptrdiff_t>(this->group.size()) != n){
+        this->setup(n);
+    }
+
+    // Local matrices are rebuilt each time; EigenCholesky keeps its
+    // symbolic analysis as long as their patterns stay the same
+    const std::ptrdiff_t ns = this->subdomains.size();
+    #pragma omp parallel
+    {
+        std::vector<std::ptrdiff_t> local(n, -1);
+        std::vector<std::ptrdiff_t> outer, inner;
+        std::vector<double> values;
+        #pragma omp for schedule(dynamic)
+        for(std::ptrdiff_t s = 0; s < ns; ++s){
+            auto& sub = this->subdomains[s];
+            const std::ptrdiff_t size = sub.dofs.size();
+            for(std::ptrdiff_t i = 0; i < size; ++i){
+                local[sub.dofs[i]] = i;
+            }
+            outer.assign(1, 0);
+            inner.clear();
+            values.clear();
+            for(std::ptrdiff_t j = 0; j < size; ++j){
+                for(LinearOperator::MatMap::InnerIterator it(*K, sub.dofs[j]); it; ++it){
+                    const std::ptrdiff_t i = local[it.row()];
+                    if(i > -1){
+                        inner.push_back(i);
+                        values.push_back(it.value());
+                    }
+                }
+                outer.push_back(inner.size());
+            }
+            for(const auto d:sub.dofs){
+                local[d] = -1;
+            }
+            sub.factor->set_K(Eigen::Map<const EigenCholesky::Mat>(size, size, inner.size(), outer.data(), inner.data(), values.data()));
+            sub.factor->compute();
+        }
+    }
+
+    if(!this->coarse){
+        return;
+    }
+    // E = Z^T*K*Z, from both triangles of the stored lower one
+    Eigen::MatrixXd E = Eigen::MatrixXd::Zero(this->m, this->m);
+    for(std::ptrdiff_t c = 0; c < K->outerSize(); ++c){
+        const long gc = this->group[c];
+        if(gc < 0){
+            continue;
+        }
+        for(LinearOperator::MatMap::InnerIterator it(*K, c); it; ++it){
+            const long gr = this->group[it.row()];
+            if(gr > -1){
+                E(gr, gc) += it.value();
+                if(it.row() != c){
+                    E(gc, gr) += it.value();
+                }
+            }
+        }
+    }
+    this->E.compute(E);
+}
+
+void SchwarzPreconditioner::apply(const Eigen::VectorXd& r, Eigen::VectorXd& z) const{
+    const std::ptrdiff_t ns = this->subdomains.size();
+    #pragma omp parallel for schedule(dynamic)
+    for(std::ptrdiff_t s = 0; s < ns; ++s){
+        const auto& sub = this->subdomains[s];
+        const std::ptrdiff_t size = sub.dofs.size();
+        sub.r.resize(size);
+        for(std::ptrdiff_t i = 0; i < size; ++i){
+            sub.r[i] = r[sub.dofs[i]];
+        }
+        sub.factor->solve(sub.z, sub.r);
+    }
+
+    // Overlapping subdomains add to the same DOFs, so the local solutions
+    // are summed serially
+    z.setZero(r.size());
+    for(const auto& sub:this->subdomains){
+        for(size_t i = 0; i < sub.dofs.size(); ++i){
+            z[sub.dofs[i]] += sub.z[i];
+        }
+    }
+
+    if(!this->coarse){
+        return;
+    }
+    Eigen::VectorXd c = Eigen::VectorXd::Zero(this->m);
+    for(std::ptrdiff_t i = 0; i < r.size(); ++i){
+        if(this->group[i] > -1){
+            c[this->group[i]] += r[i];
+        }
+    }
+    c = this->E.solve(c);
+    for(std::ptrdiff_t i = 0; i < z.size(); ++i){
+        if(this->group[i] > -1){
+            z[i] += c[this->group[i]];
+        }
+    }
+}
+
+}
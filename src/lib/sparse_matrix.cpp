@@ -19,11 +19,114 @@
  */
 
 #include "lib/sparse_matrix.hpp"
+#include "lib/spmv.hpp"
 #include <set>
 
 namespace dplib{
 
+void SparseMatrix::generate_pattern(const std::vector<size_t>& element_nodes, const std::vector<long>& node_vector_mapping, const size_t nodes_per_element, const size_t dof_per_node, const size_t L){
+    const size_t W = nodes_per_element*dof_per_node;
+    const size_t number_of_elements = element_nodes.size()/nodes_per_element;
+    this->element_size = W;
+    this->slots_per_element = W*(W+1)/2;
+    ++this->revision;
+
+    auto get_pos = [&](size_t e, std::vector<long>& pos){
+        for(size_t n = 0; n < nodes_per_element; ++n){
+            const size_t node_id = element_nodes[e*nodes_per_element + n];
+            for(size_t i = 0; i < dof_per_node; ++i){
+                pos[n*dof_per_node + i] = node_vector_mapping[node_id*dof_per_node + i];
+            }
+        }
+    };
+
+    // Count (with repetitions) and fill each column
+    std::vector<std::ptrdiff_t> start(L+1, 0);
+    std::vector<long> pos(W, 0);
+    for(size_t e = 0; e < number_of_elements; ++e){
+        get_pos(e, pos);
+        for(size_t i = 0; i < W; ++i){
+            for(size_t j = 0; j <= i; ++j){
+                if(pos[i] > -1 && pos[j] > -1){
+                    ++start[std::min(pos[i], pos[j]) + 1];
+                }
+            }
+        }
+    }
+    for(size_t j = 0; j < L; ++j){
+        start[j+1] += start[j];
+    }
+    std::vector<std::ptrdiff_t> rows(start[L]);
+    std::vector<std::ptrdiff_t> next(start.begin(), start.end() - 1);
+    for(size_t e = 0; e < number_of_elements; ++e){
+        get_pos(e, pos);
+        for(size_t i = 0; i < W; ++i){
+            for(size_t j = 0; j <= i; ++j){
+                if(pos[i] > -1 && pos[j] > -1){
+                    rows[next[std::min(pos[i], pos[j])]++] = std::max(pos[i], pos[j]);
+                }
+            }
+        }
+    }
+
+    // Sort and remove duplicates
+    this->outer.assign(L+1, 0);
+    this->inner.clear();
+    this->inner.reserve(rows.size()/2);
+    this->kl = 0;
+    for(size_t j = 0; j < L; ++j){
+        auto b = rows.begin() + start[j];
+        auto e = rows.begin() + start[j+1];
+        std::sort(b, e);
+        e = std::unique(b, e);
+        this->inner.insert(this->inner.end(), b, e);
+        this->outer[j+1] = this->inner.size();
+        if(b != e && static_cast<size_t>(*(e-1)) - j > this->kl){
+            this->kl = *(e-1) - j;
+        }
+    }
+    this->inner.shrink_to_fit();
+    this->values.assign(this->inner.size(), 0);
+    this->L = L;
+
+    // Element-to-slot map
+    this->element_slots.resize(number_of_elements*this->slots_per_element);
+    #pragma omp parallel for firstprivate(pos)
+    for(size_t e = 0; e < number_of_elements; ++e){
+        get_pos(e, pos);
+        long* slots = this->element_slots.data() + e*this->slots_per_element;
+        size_t k = 0;
+        for(size_t i = 0; i < W; ++i){
+            for(size_t j = 0; j <= i; ++j, ++k){
+                if(pos[i] > -1 && pos[j] > -1){
+                    slots[k] = this->find_slot(std::max(pos[i], pos[j]), std::min(pos[i], pos[j]));
+                } else {
+                    slots[k] = -1;
+                }
+            }
+        }
+    }
+}
+
+long SparseMatrix::find_slot(size_t i, size_t j) const{
+    if(j + 1 >= this->outer.size()){
+        return -1;
+    }
+    const auto b = this->inner.begin() + this->outer[j];
+    const auto e = this->inner.begin() + this->outer[j+1];
+    const auto p = std::lower_bound(b, e, static_cast<std::ptrdiff_t>(i));
+    if(p != e && *p == static_cast<std::ptrdiff_t>(i)){
+        return p - this->inner.begin();
+    }
+    return -1;
+}
+
 void SparseMatrix::set(size_t i, size_t j, double val){
+    const long slot = this->find_slot(i, j);
+    if(slot > -1){
+        this->values[slot] = val;
+        return;
+    }
     this->data[Point(i, j)] = val;
     size_t k = 0;
     if(j > i){
@@ -40,6 +143,11 @@ void SparseMatrix::set(size_t i, size_t j, double val){
 }
 
 void SparseMatrix::add(size_t i, size_t j, double val){
+    const long slot = this->find_slot(i, j);
+    if(slot > -1){
+        this->values[slot] += val;
+        return;
+    }
     this->data[Point(i, j)] += val;
     size_t k = 0;
     if(j > i){
@@ -55,7 +163,30 @@ void SparseMatrix::add(size_t i, size_t j, double val){
     }
 }
 
+void SparseMatrix::shift_diagonal(double sigma){
+    const size_t N = this->matrix_size();
+    if(!this->has_pattern()){
+        for(size_t i = 0; i < N; ++i){
+            this->add(i, i, sigma);
+        }
+        return;
+    }
+    for(size_t j = 0; j < N; ++j){
+        const std::ptrdiff_t p = this->outer[j];
+        if(p < this->outer[j+1] && this->inner[p] == static_cast<std::ptrdiff_t>(j)){
+            this->values[p] += sigma;
+        } else {
+            // DOF without elements
+            this->add(j, j, sigma);
+        }
+    }
+}
+
 double SparseMatrix::get(size_t i, size_t j) const{
+    const long slot = this->find_slot(i, j);
+    if(slot > -1){
+        return this->values[slot];
+    }
     auto pos = this->data.find(Point(i, j));
     if(pos != this->data.end()){
         return pos->second;
@@ -69,9 +200,7 @@ void SparseMatrix::calculate_dimensions(){
     this->L = 0;
 
     size_t k = 0;
-    for(auto& v:this->data){
-        size_t i = v.first.i;
-        size_t j = v.first.j;
+    this->for_each([&](size_t i, size_t j, double){
         if(j > i){
             k = j - i;
             if(k > this->ku){
@@ -86,7 +215,7 @@ void SparseMatrix::calculate_dimensions(){
         if(i > this->L){
             this->L = i;
         }
-    }
+    });
     ++this->L;
 }
 
@@ -103,12 +232,26 @@ void SparseMatrix::insert_matrix(std::vector<double> M, std::vector<long> pos){
     }
 }
 
-std::vector<double> SparseMatrix::multiply(std::vector<double> vec) const{
+std::vector<double> SparseMatrix::multiply(const std::vector<double>& vec) const{
     std::vector<double> result(vec.size(), 0);
-    for(auto& v:this->data){
-        size_t i = v.first.i;
-        size_t j = v.first.j;
-        result[i] = v.second*vec[j];
+    if(this->has_pattern()){
+        SpMV spmv;
+        spmv.set_lower(this->outer.size() - 1, this->outer.data(), this->inner.data(), this->values.data());
+        spmv.multiply(vec.data(), result.data());
+    }
+    // Entries of either triangle stand for both (i, j) and (j, i). When
+    // both are stored (insert_matrix() stores full element matrices), the
+    // upper one is skipped.
+    for(const auto& v:this->data){
+        const size_t i = v.first.i;
+        const size_t j = v.first.j;
+        if(i < j && (this->find_slot(j, i) > -1 || this->data.count(Point(j, i)) > 0)){
+            continue;
+        }
+        result[i] += v.second*vec[j];
+        if(i != j){
+            result[j] += v.second*vec[i];
+        }
     }
 
     return result;
@@ -119,41 +262,74 @@ std::vector<double> SparseMatrix::to_general_band(size_t diag_size, size_t& ku,
     kl = this->kl;
     size_t H = kl + ku + 1;
     std::vector<double> band(H*diag_size, 0);
-    for(auto& v:this->data){
-        Point place = this->point_to_general_band(v.first);
-        band[place.i*diag_size + place.j] = v.second;
-    }
+    this->for_each([&](size_t i, size_t j, double v){
+        Point place = this->point_to_general_band(Point(i, j));
+        band[place.i*diag_size + place.j] = v;
+    });
+
+    return band;
+}
+
+std::vector<double> SparseMatrix::to_symmetric_band(size_t diag_size, size_t& kd) const{
+    kd = 0;
+    this->for_each([&](size_t i, size_t j, double){
+        const size_t k = (i > j) ? i - j : j - i;
+        if(k > kd){
+            kd = k;
+        }
+    });
+    const size_t H = kd + 1;
+    std::vector<double> band(H*diag_size, 0);
+    this->for_each([&](size_t i, size_t j, double v){
+        if(i >= j){
+            band[j*H + (i - j)] = v;
+        } else {
+            band[i*H + (j - i)] = v;
+        }
+    });
 
     return band;
 }
 
 void SparseMatrix::zero(){
+    std::fill(this->values.begin(), this->values.end(), 0);
     for(auto& v:this->data){
         v.second = 0;    
     }
 }
 
+void SparseMatrix::clear(){
+    this->data.clear();
+    this->outer.clear();
+    this->inner.clear();
+    this->values.clear();
+    this->element_slots.clear();
+    ++this->revision;
+}
+
 void SparseMatrix::merge(SparseMatrix& M){
-    this->data.reserve(this->data.size() + M.data.size());
-    this->data.merge(M.data);
-    for(const auto& v:M.data){
-        this->data[v.first] += v.second;
+    if(!M.has_pattern() && !this->has_pattern()){
+        this->data.reserve(this->data.size() + M.data.size());
+        this->data.merge(M.data);
     }
+    M.for_each([this](size_t i, size_t j, double v){
+        this->add(i, j, v);
+    });
 }
 void SparseMatrix::to_mumps_format(std::vector<int>& rows, std::vector<int>& cols, std::vector<double>& vals) const{
-    size_t N = this->data.size();
+    size_t N = this->nnz();
     if(N > rows.size()){
         rows.resize(N, 0);
         cols.resize(N, 0);
         vals.resize(N, 0);
     }
-    auto v = this->data.cbegin();
-    for(size_t i = 0; i < N; ++i){
-        rows[i] = v->first.i+1;
-        cols[i] = v->first.j+1;
-        vals[i] = v->second;
-        ++v;
-    }
+    size_t k = 0;
+    this->for_each([&](size_t i, size_t j, double v){
+        rows[k] = i+1;
+        cols[k] = j+1;
+        vals[k] = v;
+        ++k;
+    });
 }
 
 SparseMatrix::Point SparseMatrix::point_to_general_band(Point p) const{
@@ -171,41 +347,43 @@ SparseMatrix::Point SparseMatrix::point_to_general_band(Point p) const{
 std::vector<std::ptrdiff_t> SparseMatrix::eigen_resize_vector(){
     this->calculate_dimensions();
     std::vector<std::ptrdiff_t> sizes(L,0);
-    for(const auto& p:this->data){
-        ++sizes[p.first.j];
-    }
+    this->for_each([&sizes](size_t, size_t j, double){
+        ++sizes[j];
+    });
 
     return sizes;
 }
 
 std::vector<size_t> SparseMatrix::affected_ids(const std::vector<size_t>& ids) const{
     std::set<size_t> affected;
-    size_t cur_i = this->data.begin()->first.i;
+    bool first = true;
+    size_t cur_i = 0;
     size_t cur_id = 0;
     bool skip_line = false;
-    for(auto& v:this->data){
-        if(cur_i != v.first.i){
-            cur_i = v.first.i;
+    this->for_each([&](size_t i, size_t j, double v){
+        if(first || cur_i != i){
+            first = false;
+            cur_i = i;
             cur_id = 0;
             skip_line = false;
         }
         if(skip_line){
-            continue;
+            return;
         }
-        if(v.first.j < ids[cur_id]){
-            continue;
+        if(j < ids[cur_id]){
+            return;
         }
-        if(v.first.j > ids[cur_id]){
+        if(j > ids[cur_id]){
             ++cur_id;
         }
-        if(v.first.j == ids[cur_id]){
-            if(v.second != 0){
-                affected.insert(v.first.i);
+        if(j == ids[cur_id]){
+            if(v != 0){
+                affected.insert(i);
                 skip_line = true;
             }
             ++cur_id;
         }
-    }
+    });
     std::vector<size_t> aff(affected.begin(), affected.end());
 
     return aff;
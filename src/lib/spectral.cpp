@@ -0,0 +1,242 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <omp.h>
+#include "lib/print.hpp"
+#include "lib/spectral.hpp"
+
+namespace dplib{
+
+void SpectralPreconditioner::Axis::setup(size_t nodes, bool dirichlet_begin, bool dirichlet_end){
+    // Sine modes vanish at a Dirichlet node j = 0, cosine modes have zero
+    // slope at a free one. The other end fixes the frequencies.
+    this->cosine = !dirichlet_begin;
+    this->first = dirichlet_begin ? 1 : 0;
+    this->n = nodes - this->first - (dirichlet_end ? 1 : 0);
+    if(dirichlet_begin && dirichlet_end){
+        this->P = this->n + 1;
+        this->shift = 1;
+    } else if(dirichlet_begin != dirichlet_end){
+        this->P = this->n;
+        this->shift = 0.5;
+    } else {
+        this->P = this->n - 1;
+        this->shift = 0;
+    }
+
+    this->weight.assign(this->n, 1.0);
+    if(!dirichlet_begin){
+        this->weight.front() = 0.5;
+    }
+    if(!dirichlet_end){
+        this->weight.back() = 0.5;
+    }
+
+    this->twiddle.resize(2*this->P);
+    for(size_t j = 0; j < 2*this->P; ++j){
+        this->twiddle[j] = std::polar(1.0, -M_PI*j*this->shift/this->P);
+    }
+
+    this->norm.assign(this->n, 0.0);
+    this->stiffness.resize(this->n);
+    this->mass.resize(this->n);
+    for(size_t k = 0; k < this->n; ++k){
+        const double theta = M_PI*(k + this->shift)/this->P;
+        this->stiffness[k] = 2*(1 - std::cos(theta));
+        this->mass[k] = (4 + 2*std::cos(theta))/6;
+        for(size_t i = 0; i < this->n; ++i){
+            const double j = this->first + i;
+            const double v = this->cosine ? std::cos(j*theta) : std::sin(j*theta);
+            this->norm[k] += this->weight[i]*v*v;
+        }
+    }
+}
+
+void SpectralPreconditioner::Axis::analysis(const double* x, double* y, Eigen::FFT<double>& fft, ComplexVector& in, ComplexVector& out) const{
+    in.assign(2*this->P, 0.0);
+    for(size_t i = 0; i < this->n; ++i){
+        const size_t j = this->first + i;
+        in[j] = x[i]*this->twiddle[j];
+    }
+    fft.fwd(out, in);
+    for(size_t k = 0; k < this->n; ++k){
+        y[k] = this->cosine ? out[k].real() : -out[k].imag();
+    }
+}
+
+void SpectralPreconditioner::Axis::synthesis(const double* y, double* x, Eigen::FFT<double>& fft, ComplexVector& in, ComplexVector& out) const{
+    in.assign(2*this->P, 0.0);
+    std::copy(y, y + this->n, in.begin());
+    fft.fwd(out, in);
+    for(size_t i = 0; i < this->n; ++i){
+        const size_t j = this->first + i;
+        const std::complex<double> v = out[j]*this->twiddle[j];
+        x[i] = this->cosine ? v.real() : -v.imag();
+    }
+}
+
+SpectralPreconditioner::SpectralPreconditioner(size_t W, size_t H, std::vector<long> dofs):
+    W(W), H(H), dofs(std::move(dofs)){
+
+    if(this->dofs.size() != (W+1)*(H+1)){
+        print_line("ERROR: SpectralPreconditioner DOF map does not match the grid size.");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void SpectralPreconditioner::compute(const LinearOperator& A){
+    const auto dirichlet = [this](size_t x0, size_t y0, size_t x1, size_t y1){
+        for(size_t y = y0; y <= y1; ++y){
+            for(size_t x = x0; x <= x1; ++x){
+                if(this->dofs[y*(W+1) + x] > -1){
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+    this->X.setup(W+1, dirichlet(0, 0, 0, H), dirichlet(W, 0, W, H));
+    this->Y.setup(H+1, dirichlet(0, 0, W, 0), dirichlet(0, H, W, H));
+    const size_t nx = this->X.n;
+    const size_t ny = this->Y.n;
+
+    // Ratio between diag(K) and the diagonal of the unit coefficient
+    // operator, (8/3)*wx*wy
+    const Eigen::VectorXd d = A.diagonal();
+    this->inv_diag = d.cwiseInverse();
+    Eigen::VectorXd ratio = Eigen::VectorXd::Zero(A.size());
+    double max_ratio = 0;
+    for(size_t y = 0; y < ny; ++y){
+        for(size_t x = 0; x < nx; ++x){
+            const long i = this->dofs[(this->Y.first + y)*(W+1) + this->X.first + x];
+            if(i > -1){
+                ratio[i] = d[i]/(8.0/3.0*this->X.weight[x]*this->Y.weight[y]);
+                max_ratio = std::max(max_ratio, ratio[i]);
+                this->inv_diag[i] = 0;
+            }
+        }
+    }
+    // Rows without off-diagonal entries to speak of (such as the inside of
+    // the ring with K_MIN = 0, held only by I_MIN) are solved exactly by
+    // their diagonal, and would be badly off in the spectral part
+    std::vector<bool> decoupled(A.size(), false);
+    if(const auto* K = A.matrix()){
+        Eigen::VectorXd off = Eigen::VectorXd::Zero(A.size());
+        for(std::ptrdiff_t j = 0; j < K->outerSize(); ++j){
+            for(LinearOperator::MatMap::InnerIterator it(*K, j); it; ++it){
+                if(it.row() != j){
+                    off[it.row()] += std::abs(it.value());
+                    off[j] += std::abs(it.value());
+                }
+            }
+        }
+        for(std::ptrdiff_t i = 0; i < off.size(); ++i){
+            decoupled[i] = off[i] < 1e-6*d[i];
+        }
+    }
+    this->inv_scale.resize(A.size());
+    for(std::ptrdiff_t i = 0; i < ratio.size(); ++i){
+        if(decoupled[i]){
+            this->inv_scale[i] = 0;
+            this->inv_diag[i] = 1.0/d[i];
+            continue;
+        }
+        const double r = this->scaling ? ratio[i] : max_ratio;
+        this->inv_scale[i] = (r > 0) ? 1.0/std::sqrt(r) : 0.0;
+    }
+
+    // Zero for the constant mode of a fully free grid
+    this->inv_lambda.resize(nx*ny);
+    double max_lambda = 0;
+    for(size_t l = 0; l < ny; ++l){
+        for(size_t k = 0; k < nx; ++k){
+            max_lambda = std::max(max_lambda, this->X.stiffness[k]*this->Y.mass[l] + this->X.mass[k]*this->Y.stiffness[l]);
+        }
+    }
+    for(size_t l = 0; l < ny; ++l){
+        for(size_t k = 0; k < nx; ++k){
+            const double lambda = this->X.stiffness[k]*this->Y.mass[l] + this->X.mass[k]*this->Y.stiffness[l];
+            this->inv_lambda[l*nx + k] = (lambda > 1e-14*max_lambda) ? 1.0/(lambda*this->X.norm[k]*this->Y.norm[l]) : 0.0;
+        }
+    }
+
+    this->fft.resize(omp_get_max_threads());
+}
+
+void SpectralPreconditioner::apply(const Eigen::VectorXd& r, Eigen::VectorXd& z) const{
+    const size_t nx = this->X.n;
+    const size_t ny = this->Y.n;
+    std::vector<double> G(nx*ny, 0.0);
+    for(size_t y = 0; y < ny; ++y){
+        for(size_t x = 0; x < nx; ++x){
+            const long i = this->dofs[(this->Y.first + y)*(W+1) + this->X.first + x];
+            if(i > -1){
+                G[y*nx + x] = r[i]*this->inv_scale[i];
+            }
+        }
+    }
+
+    // G = V_y*(inv_lambda .* (V_y^T*G*V_x))*V_x^T, one line at a time
+    #pragma omp parallel
+    {
+    Eigen::FFT<double>& fft = this->fft[omp_get_thread_num()];
+    ComplexVector in, out;
+    std::vector<double> line(std::max(nx, ny)), tmp(std::max(nx, ny));
+    #pragma omp for schedule(static)
+    for(size_t y = 0; y < ny; ++y){
+        this->X.analysis(&G[y*nx], line.data(), fft, in, out);
+        std::copy(line.begin(), line.begin() + nx, G.begin() + y*nx);
+    }
+    #pragma omp for schedule(static)
+    for(size_t x = 0; x < nx; ++x){
+        for(size_t y = 0; y < ny; ++y){
+            tmp[y] = G[y*nx + x];
+        }
+        this->Y.analysis(tmp.data(), line.data(), fft, in, out);
+        for(size_t l = 0; l < ny; ++l){
+            line[l] *= this->inv_lambda[l*nx + x];
+        }
+        this->Y.synthesis(line.data(), tmp.data(), fft, in, out);
+        for(size_t y = 0; y < ny; ++y){
+            G[y*nx + x] = tmp[y];
+        }
+    }
+    #pragma omp for schedule(static)
+    for(size_t y = 0; y < ny; ++y){
+        this->X.synthesis(&G[y*nx], line.data(), fft, in, out);
+        std::copy(line.begin(), line.begin() + nx, G.begin() + y*nx);
+    }
+    }
+
+    z = r.cwiseProduct(this->inv_diag);
+    for(size_t y = 0; y < ny; ++y){
+        for(size_t x = 0; x < nx; ++x){
+            const long i = this->dofs[(this->Y.first + y)*(W+1) + this->X.first + x];
+            if(i > -1){
+                z[i] = G[y*nx + x]*this->inv_scale[i];
+            }
+        }
+    }
+}
+
+}
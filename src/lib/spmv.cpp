@@ -0,0 +1,252 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "lib/spmv.hpp"
+#include <algorithm>
+#include <omp.h>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace dplib{
+
+namespace{
+
+// sum_k v[k]*x[idx[k]]
+inline double gather_dot(const std::ptrdiff_t* idx, const double* v, std::ptrdiff_t len, const double* x){
+    double sum = 0;
+    std::ptrdiff_t k = 0;
+#ifdef __AVX512F__
+    if(len >= 8){
+        __m512d acc = _mm512_setzero_pd();
+        for(; k + 8 <= len; k += 8){
+            const __m512i i = _mm512_loadu_si512(idx + k);
+            const __m512d g = _mm512_mask_i64gather_pd(_mm512_setzero_pd(), 0xFF, i, x, 8);
+            acc = _mm512_fmadd_pd(_mm512_loadu_pd(v + k), g, acc);
+        }
+        // The masked forms with a zeroed source avoid the uninitialized
+        // pass-through operand of the plain gather and reduce intrinsics
+        const __m256d lo = _mm512_mask_extractf64x4_pd(_mm256_setzero_pd(), 0xF, acc, 0);
+        const __m256d hi = _mm512_mask_extractf64x4_pd(_mm256_setzero_pd(), 0xF, acc, 1);
+        const __m256d q = _mm256_add_pd(lo, hi);
+        const __m128d h = _mm_add_pd(_mm256_castpd256_pd128(q), _mm256_extractf128_pd(q, 1));
+        sum += _mm_cvtsd_f64(_mm_add_sd(h, _mm_unpackhi_pd(h, h)));
+    }
+#endif
+#ifdef __AVX2__
+    if(k + 4 <= len){
+        __m256d acc = _mm256_setzero_pd();
+        for(; k + 4 <= len; k += 4){
+            const __m256i i = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx + k));
+            const __m256d p = _mm256_mul_pd(_mm256_loadu_pd(v + k), _mm256_i64gather_pd(x, i, 8));
+            acc = _mm256_add_pd(acc, p);
+        }
+        const __m128d h = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+        sum += _mm_cvtsd_f64(_mm_add_sd(h, _mm_unpackhi_pd(h, h)));
+    }
+#endif
+    for(; k < len; ++k){
+        sum += v[k]*x[idx[k]];
+    }
+    return sum;
+}
+
+// Returns sum_k v[k]*x[idx[k]] and does y[idx[k]] += v[k]*xj. The indices
+// must be distinct.
+inline double scatter_dot(const std::ptrdiff_t* idx, const double* v, std::ptrdiff_t len, const double* x, double xj, double* y){
+    double sum = 0;
+    std::ptrdiff_t k = 0;
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+    if(len >= 4){
+        const __m256d s = _mm256_set1_pd(xj);
+        __m256d acc = _mm256_setzero_pd();
+        for(; k + 4 <= len; k += 4){
+            const __m256i i = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx + k));
+            const __m256d a = _mm256_loadu_pd(v + k);
+            acc = _mm256_fmadd_pd(a, _mm256_i64gather_pd(x, i, 8), acc);
+            _mm256_i64scatter_pd(y, i, _mm256_fmadd_pd(a, s, _mm256_i64gather_pd(y, i, 8)), 8);
+        }
+        const __m128d h = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+        sum += _mm_cvtsd_f64(_mm_add_sd(h, _mm_unpackhi_pd(h, h)));
+    }
+#endif
+    for(; k < len; ++k){
+        sum += v[k]*x[idx[k]];
+        y[idx[k]] += v[k]*xj;
+    }
+    return sum;
+}
+
+}
+
+void SpMV::set_storage(Storage storage){
+    if(storage != this->storage){
+        this->storage = storage;
+        if(this->n > 0){
+            this->build();
+        }
+    }
+}
+
+void SpMV::set_lower(size_t n, const std::ptrdiff_t* outer, const std::ptrdiff_t* inner, const double* values){
+    this->n = n;
+    this->outer = outer;
+    this->inner = inner;
+    this->values = values;
+    this->build();
+}
+
+void SpMV::build(){
+    const std::ptrdiff_t N = this->n;
+    const std::ptrdiff_t* ptr = this->outer;
+    if(this->storage == Storage::GENERAL){
+        // Row r gets (r, j) from the columns j < r, then column r itself,
+        // so visiting the columns in order keeps the rows sorted
+        this->row_ptr.assign(N+1, 0);
+        for(std::ptrdiff_t j = 0; j < N; ++j){
+            for(auto p = this->outer[j]; p < this->outer[j+1]; ++p){
+                ++this->row_ptr[this->inner[p] + 1];
+                if(this->inner[p] != j){
+                    ++this->row_ptr[j + 1];
+                }
+            }
+        }
+        for(std::ptrdiff_t i = 0; i < N; ++i){
+            this->row_ptr[i+1] += this->row_ptr[i];
+        }
+        this->col.resize(this->row_ptr[N]);
+        this->val.resize(this->row_ptr[N]);
+        std::vector<std::ptrdiff_t> next(this->row_ptr.begin(), this->row_ptr.end() - 1);
+        for(std::ptrdiff_t j = 0; j < N; ++j){
+            for(auto p = this->outer[j]; p < this->outer[j+1]; ++p){
+                const std::ptrdiff_t i = this->inner[p];
+                this->col[next[i]] = j;
+                this->val[next[i]++] = this->values[p];
+                if(i != j){
+                    this->col[next[j]] = i;
+                    this->val[next[j]++] = this->values[p];
+                }
+            }
+        }
+        ptr = this->row_ptr.data();
+    }
+
+    // Balance the nonzeros among threads
+    const std::ptrdiff_t T = std::max(1, std::min<int>(omp_get_max_threads(), N));
+    const std::ptrdiff_t nnz = ptr[N];
+    this->part.resize(T+1);
+    this->part[0] = 0;
+    for(std::ptrdiff_t t = 1; t < T; ++t){
+        this->part[t] = std::lower_bound(ptr, ptr + N, (t*nnz)/T) - ptr;
+    }
+    this->part[T] = N;
+
+    this->buffer_end.assign(T, 0);
+    this->buffers.resize(T);
+    for(std::ptrdiff_t t = 0; t < T; ++t){
+        std::ptrdiff_t end = this->part[t+1];
+        if(this->storage == Storage::SYMMETRIC){
+            for(auto j = this->part[t]; j < this->part[t+1]; ++j){
+                if(this->outer[j+1] > this->outer[j]){
+                    end = std::max(end, this->inner[this->outer[j+1] - 1] + 1);
+                }
+            }
+        }
+        this->buffer_end[t] = end;
+        this->buffers[t].resize(end - this->part[t+1]);
+    }
+}
+
+void SpMV::multiply(const double* x, double* y) const{
+    if(this->storage == Storage::SYMMETRIC){
+        this->multiply_symmetric(x, y);
+    } else {
+        this->multiply_general(x, y);
+    }
+}
+
+void SpMV::multiply_general(const double* x, double* y) const{
+    const std::ptrdiff_t T = this->part.size() - 1;
+    #pragma omp parallel for schedule(static, 1) if(T > 1)
+    for(std::ptrdiff_t t = 0; t < T; ++t){
+        for(auto i = this->part[t]; i < this->part[t+1]; ++i){
+            const auto b = this->row_ptr[i];
+            y[i] = gather_dot(this->col.data() + b, this->val.data() + b, this->row_ptr[i+1] - b, x);
+        }
+    }
+}
+
+void SpMV::multiply_symmetric(const double* x, double* y) const{
+    const std::ptrdiff_t T = this->part.size() - 1;
+    #pragma omp parallel if(T > 1)
+    {
+        #pragma omp for schedule(static, 1)
+        for(std::ptrdiff_t t = 0; t < T; ++t){
+            const std::ptrdiff_t b = this->part[t];
+            const std::ptrdiff_t e = this->part[t+1];
+            std::vector<double>& buffer = this->buffers[t];
+            std::fill(y + b, y + e, 0);
+            std::fill(buffer.begin(), buffer.end(), 0);
+            for(std::ptrdiff_t j = b; j < e; ++j){
+                auto p = this->outer[j];
+                const auto end = this->outer[j+1];
+                const double xj = x[j];
+                double sum = 0;
+                // Rows are sorted, so only the first one may be the diagonal
+                if(p < end && this->inner[p] == j){
+                    sum = this->values[p]*xj;
+                    ++p;
+                }
+                if(p == end){
+                } else if(this->inner[end-1] < e){
+                    sum += scatter_dot(this->inner + p, this->values + p, end - p, x, xj, y);
+                } else {
+                    for(; p < end; ++p){
+                        const std::ptrdiff_t i = this->inner[p];
+                        sum += this->values[p]*x[i];
+                        if(i < e){
+                            y[i] += this->values[p]*xj;
+                        } else {
+                            buffer[i - e] += this->values[p]*xj;
+                        }
+                    }
+                }
+                y[j] += sum;
+            }
+        }
+        // Implicit barrier. Each thread then adds the parts of the earlier
+        // threads' buffers that fall into its own rows.
+        #pragma omp for schedule(static, 1)
+        for(std::ptrdiff_t t = 0; t < T; ++t){
+            const std::ptrdiff_t b = this->part[t];
+            const std::ptrdiff_t e = this->part[t+1];
+            for(std::ptrdiff_t s = 0; s < t; ++s){
+                const std::ptrdiff_t offset = this->part[s+1];
+                const std::ptrdiff_t end = std::min(e, this->buffer_end[s]);
+                for(std::ptrdiff_t i = std::max(b, offset); i < end; ++i){
+                    y[i] += this->buffers[s][i - offset];
+                }
+            }
+        }
+    }
+}
+
+}
@@ -0,0 +1,139 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include "lib/stencil_operator.hpp"
+
+namespace dplib{
+
+StencilOperator::StencilOperator(size_t W, size_t H, const std::vector<double>& k, std::vector<double> rho, std::vector<long> dofs):
+    W(W), H(H), rho(std::move(rho)), dofs(std::move(dofs)){
+
+    std::copy(k.begin(), k.begin() + 16, this->k);
+    this->n = 0;
+    for(const auto& d:this->dofs){
+        if(d > -1){
+            ++this->n;
+        }
+    }
+}
+
+void StencilOperator::apply(const Eigen::VectorXd& x, Eigen::VectorXd& y) const{
+    y.setZero(this->n);
+    // Adjacent rows of elements share a row of nodes, so even and odd rows
+    // are processed separately
+    #pragma omp parallel
+    {
+        std::vector<double> buffer(6*(this->W+1));
+        for(size_t parity = 0; parity < 2; ++parity){
+            #pragma omp for schedule(static)
+            for(size_t r = parity; r < this->H; r += 2){
+                this->apply_row(r, x, y, buffer);
+            }
+        }
+    }
+}
+
+void StencilOperator::apply_row(size_t r, const Eigen::VectorXd& x, Eigen::VectorXd& out, std::vector<double>& buffer) const{
+    const size_t N = this->W + 1;
+    const long* db = this->dofs.data() + r*N;
+    const long* dt = db + N;
+    const double* rho_row = this->rho.data() + r*this->W;
+    double* xb = buffer.data();
+    double* xt = xb + N;
+    double* fb = xt + N;
+    double* ft = fb + N;
+    double* gb = ft + N;
+    double* gt = gb + N;
+
+    for(size_t i = 0; i < N; ++i){
+        xb[i] = (db[i] > -1) ? x[db[i]] : 0;
+        xt[i] = (dt[i] > -1) ? x[dt[i]] : 0;
+    }
+    // f*: contributions to the left nodes of each element, g*: to the right
+    // ones
+    const double* k = this->k;
+    #pragma omp simd
+    for(size_t e = 0; e < this->W; ++e){
+        const double u0 = xt[e];
+        const double u1 = xt[e+1];
+        const double u2 = xb[e+1];
+        const double u3 = xb[e];
+        const double p = rho_row[e];
+        ft[e] = p*(k[ 0]*u0 + k[ 1]*u1 + k[ 2]*u2 + k[ 3]*u3);
+        gt[e] = p*(k[ 4]*u0 + k[ 5]*u1 + k[ 6]*u2 + k[ 7]*u3);
+        gb[e] = p*(k[ 8]*u0 + k[ 9]*u1 + k[10]*u2 + k[11]*u3);
+        fb[e] = p*(k[12]*u0 + k[13]*u1 + k[14]*u2 + k[15]*u3);
+    }
+    ft[this->W] = 0;
+    fb[this->W] = 0;
+    for(size_t i = 0; i < N; ++i){
+        const double left_t = (i > 0) ? gt[i-1] : 0;
+        const double left_b = (i > 0) ? gb[i-1] : 0;
+        if(db[i] > -1){
+            out[db[i]] += fb[i] + left_b;
+        }
+        if(dt[i] > -1){
+            out[dt[i]] += ft[i] + left_t;
+        }
+    }
+}
+
+Eigen::VectorXd StencilOperator::diagonal() const{
+    Eigen::VectorXd diag = Eigen::VectorXd::Zero(this->n);
+    const size_t N = this->W + 1;
+    for(size_t y = 0; y < this->H; ++y){
+        for(size_t x = 0; x < this->W; ++x){
+            const double p = this->rho[y*this->W + x];
+            const long d[4]{this->dofs[x + (y+1)*N], this->dofs[x + 1 + (y+1)*N],
+                            this->dofs[x + 1 + y*N], this->dofs[x + y*N]};
+            for(size_t i = 0; i < 4; ++i){
+                if(d[i] > -1){
+                    diag[d[i]] += p*this->k[i*4 + i];
+                }
+            }
+        }
+    }
+
+    return diag;
+}
+
+void StencilOperator::apply_dirichlet(const std::vector<double>& dirichlet, std::vector<double>& load) const{
+    const size_t N = this->W + 1;
+    for(size_t y = 0; y < this->H; ++y){
+        for(size_t x = 0; x < this->W; ++x){
+            const double p = this->rho[y*this->W + x];
+            const long d[4]{this->dofs[x + (y+1)*N], this->dofs[x + 1 + (y+1)*N],
+                            this->dofs[x + 1 + y*N], this->dofs[x + y*N]};
+            for(size_t i = 0; i < 4; ++i){
+                if(d[i] < 0){
+                    continue;
+                }
+                for(size_t j = 0; j < 4; ++j){
+                    if(d[j] < 0){
+                        load[d[i]] -= p*this->k[i*4 + j]*dirichlet[-(d[j]+1)];
+                    }
+                }
+            }
+        }
+    }
+}
+
+}
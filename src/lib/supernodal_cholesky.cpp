@@ -0,0 +1,534 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <Eigen/OrderingMethods>
+#include <algorithm>
+#include <atomic>
+#include <cblas.h>
+#include <lapacke.h>
+#include "lib/print.hpp"
+#include "lib/supernodal_cholesky.hpp"
+
+namespace dplib{
+
+namespace{
+
+typedef SupernodalCholesky::Mat Mat;
+
+// Symmetric permutation of the lower triangle of K. Each column of the
+// result holds the indices of the entries in the lower (rows >= column)
+// or upper (rows <= column) triangle of the permuted matrix, together with
+// the position of the entry in K's value array. Rows are not sorted.
+void permute(const Mat& K, const std::vector<std::ptrdiff_t>& perm, bool upper,
+             std::vector<std::ptrdiff_t>& ptr, std::vector<std::ptrdiff_t>& idx, std::vector<std::ptrdiff_t>& src){
+
+    const std::ptrdiff_t n = K.cols();
+    const auto* outer = K.outerIndexPtr();
+    const auto* inner = K.innerIndexPtr();
+
+    ptr.assign(n+1, 0);
+    for(std::ptrdiff_t c = 0; c < n; ++c){
+        for(auto p = outer[c]; p < outer[c+1]; ++p){
+            const auto i = perm[inner[p]];
+            const auto j = perm[c];
+            ++ptr[(upper ? std::max(i, j) : std::min(i, j)) + 1];
+        }
+    }
+    for(std::ptrdiff_t c = 0; c < n; ++c){
+        ptr[c+1] += ptr[c];
+    }
+    idx.resize(ptr[n]);
+    src.resize(ptr[n]);
+    std::vector<std::ptrdiff_t> next(ptr.begin(), ptr.end()-1);
+    for(std::ptrdiff_t c = 0; c < n; ++c){
+        for(auto p = outer[c]; p < outer[c+1]; ++p){
+            const auto i = perm[inner[p]];
+            const auto j = perm[c];
+            const auto col = upper ? std::max(i, j) : std::min(i, j);
+            const auto row = upper ? std::min(i, j) : std::max(i, j);
+            idx[next[col]] = row;
+            src[next[col]] = p;
+            ++next[col];
+        }
+    }
+}
+
+// Elimination tree from the upper triangle (Liu's algorithm)
+std::vector<std::ptrdiff_t> elimination_tree(const std::vector<std::ptrdiff_t>& ptr, const std::vector<std::ptrdiff_t>& idx){
+    const std::ptrdiff_t n = ptr.size() - 1;
+    std::vector<std::ptrdiff_t> parent(n, -1);
+    std::vector<std::ptrdiff_t> ancestor(n, -1);
+    for(std::ptrdiff_t i = 0; i < n; ++i){
+        for(auto p = ptr[i]; p < ptr[i+1]; ++p){
+            auto j = idx[p];
+            while(j != -1 && j < i){
+                const auto next = ancestor[j];
+                ancestor[j] = i;
+                if(next == -1){
+                    parent[j] = i;
+                }
+                j = next;
+            }
+        }
+    }
+
+    return parent;
+}
+
+// post[k] is the k-th node of a depth-first postorder
+std::vector<std::ptrdiff_t> postorder(const std::vector<std::ptrdiff_t>& parent){
+    const std::ptrdiff_t n = parent.size();
+    std::vector<std::ptrdiff_t> head(n, -1);
+    std::vector<std::ptrdiff_t> next(n, -1);
+    // Insert in reverse so that children are visited in increasing order
+    for(std::ptrdiff_t j = n-1; j >= 0; --j){
+        if(parent[j] != -1){
+            next[j] = head[parent[j]];
+            head[parent[j]] = j;
+        }
+    }
+
+    std::vector<std::ptrdiff_t> post;
+    post.reserve(n);
+    std::vector<std::ptrdiff_t> stack;
+    for(std::ptrdiff_t r = 0; r < n; ++r){
+        if(parent[r] != -1){
+            continue;
+        }
+        stack.push_back(r);
+        while(!stack.empty()){
+            const auto j = stack.back();
+            const auto c = head[j];
+            if(c == -1){
+                stack.pop_back();
+                post.push_back(j);
+            } else {
+                head[j] = next[c];
+                stack.push_back(c);
+            }
+        }
+    }
+
+    return post;
+}
+
+// Number of nonzeros in each column of L, diagonal included, by walking
+// the row subtrees
+std::vector<std::ptrdiff_t> column_counts(const std::vector<std::ptrdiff_t>& ptr, const std::vector<std::ptrdiff_t>& idx, const std::vector<std::ptrdiff_t>& parent){
+    const std::ptrdiff_t n = parent.size();
+    std::vector<std::ptrdiff_t> count(n, 0);
+    std::vector<std::ptrdiff_t> mark(n, -1);
+    for(std::ptrdiff_t i = 0; i < n; ++i){
+        mark[i] = i;
+        ++count[i];
+        for(auto p = ptr[i]; p < ptr[i+1]; ++p){
+            for(auto j = idx[p]; mark[j] != i; j = parent[j]){
+                ++count[j];
+                mark[j] = i;
+            }
+        }
+    }
+
+    return count;
+}
+
+// Whether to merge a supernode with `nc` columns into its parent, given the
+// explicit zeros the merged block would have
+bool relax(std::ptrdiff_t nc, std::ptrdiff_t m, double zeros){
+    const double entries = nc*m - nc*(nc-1)/2;
+    const double z = zeros/entries;
+
+    return nc <= 4 || (nc <= 16 && z < 0.8) || (nc <= 48 && z < 0.1) || z < 0.05;
+}
+
+}
+
+void SupernodalCholesky::set_K(SparseMatrix& M, size_t L){
+    if(!this->first_time && static_cast<size_t>(this->K.rows()) == L && M.update_eigen_values(this->K)){
+        return;
+    }
+    this->first_time = true;
+    this->K = Mat(L, L);
+    M.to_eigen_sparse(this->K);
+}
+
+void SupernodalCholesky::set_K(const Mat& K){
+    if(!this->first_time && this->K.rows() == K.rows() && this->K.nonZeros() == K.nonZeros() && K.isCompressed()){
+        if(std::equal(K.outerIndexPtr(), K.outerIndexPtr() + K.outerSize() + 1, this->K.outerIndexPtr()) &&
+           std::equal(K.innerIndexPtr(), K.innerIndexPtr() + K.nonZeros(), this->K.innerIndexPtr())){
+            std::copy(K.valuePtr(), K.valuePtr() + K.nonZeros(), this->K.valuePtr());
+            return;
+        }
+    }
+    this->first_time = true;
+    this->K = K;
+    this->K.makeCompressed();
+}
+
+void SupernodalCholesky::compute(){
+    if(this->first_time){
+        this->analyze();
+        this->first_time = false;
+    }
+    this->factorize();
+}
+
+void SupernodalCholesky::analyze(){
+    const std::ptrdiff_t n = this->K.rows();
+
+    // Fill-reducing ordering
+    std::vector<std::ptrdiff_t> order(n);
+    if(this->ordering == Ordering::AMD){
+        const Mat full = this->K.selfadjointView<Eigen::Lower>();
+        Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, std::ptrdiff_t> Pinv;
+        Eigen::AMDOrdering<std::ptrdiff_t> amd;
+        amd(full, Pinv);
+        for(std::ptrdiff_t i = 0; i < n; ++i){
+            order[Pinv.indices()[i]] = i;
+        }
+    } else {
+        for(std::ptrdiff_t i = 0; i < n; ++i){
+            order[i] = i;
+        }
+    }
+
+    // Postorder the elimination tree so that supernodes are contiguous
+    std::vector<std::ptrdiff_t> ptr, idx, src;
+    permute(this->K, order, true, ptr, idx, src);
+    const auto post = postorder(elimination_tree(ptr, idx));
+    std::vector<std::ptrdiff_t> post_inv(n);
+    for(std::ptrdiff_t k = 0; k < n; ++k){
+        post_inv[post[k]] = k;
+    }
+    this->perm.resize(n);
+    for(std::ptrdiff_t i = 0; i < n; ++i){
+        this->perm[i] = post_inv[order[i]];
+    }
+
+    permute(this->K, this->perm, true, ptr, idx, src);
+    const auto parent = elimination_tree(ptr, idx);
+    const auto count = column_counts(ptr, idx, parent);
+
+    std::vector<std::ptrdiff_t> number_of_children(n, 0);
+    for(std::ptrdiff_t j = 0; j < n; ++j){
+        if(parent[j] != -1){
+            ++number_of_children[parent[j]];
+        }
+    }
+
+    // Fundamental supernodes, merged with their parents while the extra
+    // zeros are acceptable. Only the last child of a supernode is adjacent
+    // to it in the postorder, so only that one can be merged.
+    this->super_begin.assign(1, 0);
+    std::ptrdiff_t cur_nc = 0;
+    std::ptrdiff_t cur_m = 0;
+    double cur_zeros = 0;
+    for(std::ptrdiff_t j = 0; j < n;){
+        std::ptrdiff_t end = j + 1;
+        while(end < n && parent[end-1] == end && count[end-1] == count[end] + 1 && number_of_children[end] == 1){
+            ++end;
+        }
+        const std::ptrdiff_t nc = end - j;
+        const std::ptrdiff_t m = count[j];
+        if(cur_nc > 0 && parent[j-1] == j){
+            const std::ptrdiff_t merged_m = cur_nc + m;
+            const double zeros = cur_zeros + cur_nc*(merged_m - cur_m);
+            if(relax(cur_nc + nc, merged_m, zeros)){
+                cur_nc += nc;
+                cur_m = merged_m;
+                cur_zeros = zeros;
+                j = end;
+                continue;
+            }
+        }
+        if(cur_nc > 0){
+            this->super_begin.push_back(j);
+        }
+        cur_nc = nc;
+        cur_m = m;
+        cur_zeros = 0;
+        j = end;
+    }
+    this->super_begin.push_back(n);
+    const size_t S = this->super_begin.size() - 1;
+
+    std::vector<std::ptrdiff_t> column_super(n);
+    for(size_t s = 0; s < S; ++s){
+        std::fill(column_super.begin() + this->super_begin[s], column_super.begin() + this->super_begin[s+1], s);
+    }
+    this->super_parent.resize(S);
+    this->children.assign(S, std::vector<std::ptrdiff_t>());
+    for(size_t s = 0; s < S; ++s){
+        const auto p = parent[this->super_begin[s+1]-1];
+        this->super_parent[s] = (p == -1) ? -1 : column_super[p];
+        if(p != -1){
+            this->children[column_super[p]].push_back(s);
+        }
+    }
+
+    // Row structure, assembly and extend-add maps
+    permute(this->K, this->perm, false, ptr, idx, src);
+    this->rows.clear();
+    this->rows_begin.assign(1, 0);
+    this->Lx_begin.assign(1, 0);
+    this->assembly_source.clear();
+    this->assembly_target.clear();
+    this->assembly_begin.assign(1, 0);
+    this->relative.clear();
+    this->relative_begin.assign(S, 0);
+    this->nnz_L = 0;
+    this->flops = 0;
+    std::vector<std::ptrdiff_t> mark(n, -1);
+    std::vector<std::ptrdiff_t> pos(n, 0);
+    for(size_t s = 0; s < S; ++s){
+        const auto f = this->super_begin[s];
+        const auto l = this->super_begin[s+1];
+        const size_t begin = this->rows.size();
+        for(auto j = f; j < l; ++j){
+            this->rows.push_back(j);
+            mark[j] = s;
+        }
+        for(auto j = f; j < l; ++j){
+            for(auto p = ptr[j]; p < ptr[j+1]; ++p){
+                if(mark[idx[p]] != static_cast<std::ptrdiff_t>(s)){
+                    mark[idx[p]] = s;
+                    this->rows.push_back(idx[p]);
+                }
+            }
+        }
+        for(const auto c:this->children[s]){
+            for(auto k = this->rows_begin[c] + this->columns(c); k < this->rows_begin[c+1]; ++k){
+                if(mark[this->rows[k]] != static_cast<std::ptrdiff_t>(s)){
+                    mark[this->rows[k]] = s;
+                    this->rows.push_back(this->rows[k]);
+                }
+            }
+        }
+        std::sort(this->rows.begin() + begin + (l - f), this->rows.end());
+        this->rows_begin.push_back(this->rows.size());
+
+        const std::ptrdiff_t nc = l - f;
+        const std::ptrdiff_t m = this->rows.size() - begin;
+        const std::ptrdiff_t r = m - nc;
+        for(std::ptrdiff_t k = 0; k < m; ++k){
+            pos[this->rows[begin + k]] = k;
+        }
+        for(auto j = f; j < l; ++j){
+            for(auto p = ptr[j]; p < ptr[j+1]; ++p){
+                this->assembly_source.push_back(src[p]);
+                this->assembly_target.push_back(this->Lx_begin[s] + (j-f)*m + pos[idx[p]]);
+            }
+        }
+        this->assembly_begin.push_back(this->assembly_source.size());
+        for(const auto c:this->children[s]){
+            this->relative_begin[c] = this->relative.size();
+            for(auto k = this->rows_begin[c] + this->columns(c); k < this->rows_begin[c+1]; ++k){
+                this->relative.push_back(pos[this->rows[k]]);
+            }
+        }
+        this->Lx_begin.push_back(this->Lx_begin[s] + m*nc);
+
+        this->nnz_L += m*nc - nc*(nc-1)/2;
+        this->flops += nc*static_cast<double>(nc)*nc/3.0 + r*static_cast<double>(nc)*nc + r*static_cast<double>(r)*nc;
+    }
+    this->Lx.resize(this->Lx_begin.back());
+}
+
+void SupernodalCholesky::factorize(){
+    const size_t S = this->number_of_supernodes();
+    std::vector<std::vector<double>> updates(S);
+    std::vector<std::atomic<size_t>> pending(S);
+    for(size_t s = 0; s < S; ++s){
+        pending[s] = this->children[s].size();
+    }
+
+    // Each task factors a leaf and then keeps climbing the tree for as
+    // long as it is the last child to finish
+    #pragma omp parallel
+    #pragma omp single
+    for(size_t s = 0; s < S; ++s){
+        if(!this->children[s].empty()){
+            continue;
+        }
+        #pragma omp task firstprivate(s) shared(updates, pending)
+        {
+            std::ptrdiff_t t = s;
+            while(t != -1){
+                this->factorize_supernode(t, updates);
+                t = this->super_parent[t];
+                if(t != -1 && pending[t].fetch_sub(1) != 1){
+                    t = -1;
+                }
+            }
+        }
+    }
+}
+
+void SupernodalCholesky::factorize_supernode(size_t s, std::vector<std::vector<double>>& updates){
+    const std::ptrdiff_t nc = this->columns(s);
+    const std::ptrdiff_t m = this->height(s);
+    const std::ptrdiff_t r = m - nc;
+    double* L = this->Lx.data() + this->Lx_begin[s];
+    const double* values = this->K.valuePtr();
+
+    std::fill(L, L + m*nc, 0);
+    for(size_t q = this->assembly_begin[s]; q < this->assembly_begin[s+1]; ++q){
+        this->Lx[this->assembly_target[q]] += values[this->assembly_source[q]];
+    }
+
+    std::vector<double> U(r*r, 0);
+    for(const auto c:this->children[s]){
+        const std::ptrdiff_t rc = this->height(c) - this->columns(c);
+        const double* Uc = updates[c].data();
+        const std::ptrdiff_t* rel = this->relative.data() + this->relative_begin[c];
+        for(std::ptrdiff_t k = 0; k < rc; ++k){
+            const auto t = rel[k];
+            if(t < nc){
+                for(std::ptrdiff_t i = k; i < rc; ++i){
+                    L[t*m + rel[i]] += Uc[k*rc + i];
+                }
+            } else {
+                double* Ut = U.data() + (t-nc)*r;
+                for(std::ptrdiff_t i = k; i < rc; ++i){
+                    Ut[rel[i] - nc] += Uc[k*rc + i];
+                }
+            }
+        }
+        std::vector<double>().swap(updates[c]);
+    }
+
+    const auto info = LAPACKE_dpotrf(LAPACK_COL_MAJOR, 'L', nc, L, m);
+    if(info != 0){
+        print_line("ERROR: matrix is not positive definite (supernodal Cholesky, info = " + std::to_string(info) + ").");
+        exit(EXIT_FAILURE);
+    }
+    if(r > 0){
+        cblas_dtrsm(CblasColMajor, CblasRight, CblasLower, CblasTrans, CblasNonUnit, r, nc, 1.0, L, m, L + nc, m);
+        cblas_dsyrk(CblasColMajor, CblasLower, CblasNoTrans, r, nc, -1.0, L + nc, m, 1.0, U.data(), r);
+    }
+    updates[s] = std::move(U);
+}
+
+void SupernodalCholesky::solve(std::vector<double>& x, std::vector<double>& b){
+    const std::ptrdiff_t n = this->K.rows();
+    std::vector<double> y(n);
+    for(std::ptrdiff_t i = 0; i < n; ++i){
+        y[this->perm[i]] = b[i];
+    }
+    this->solve_permuted(y.data(), 1);
+    for(std::ptrdiff_t i = 0; i < n; ++i){
+        x[i] = y[this->perm[i]];
+    }
+}
+
+void SupernodalCholesky::solve(Eigen::VectorXd& x, const Eigen::VectorXd& b) const{
+    const std::ptrdiff_t n = this->K.rows();
+    Eigen::VectorXd y(n);
+    for(std::ptrdiff_t i = 0; i < n; ++i){
+        y[this->perm[i]] = b[i];
+    }
+    this->solve_permuted(y.data(), 1);
+    x.resize(n);
+    for(std::ptrdiff_t i = 0; i < n; ++i){
+        x[i] = y[this->perm[i]];
+    }
+}
+
+void SupernodalCholesky::solve(Eigen::MatrixXd& X, const Eigen::MatrixXd& B) const{
+    const std::ptrdiff_t n = this->K.rows();
+    const std::ptrdiff_t k = B.cols();
+    Eigen::MatrixXd Y(n, k);
+    for(std::ptrdiff_t i = 0; i < n; ++i){
+        Y.row(this->perm[i]) = B.row(i);
+    }
+    this->solve_permuted(Y.data(), k);
+    X.resize(n, k);
+    for(std::ptrdiff_t i = 0; i < n; ++i){
+        X.row(i) = Y.row(this->perm[i]);
+    }
+}
+
+void SupernodalCholesky::solve_permuted(double* y, std::ptrdiff_t k) const{
+    const std::ptrdiff_t n = this->K.rows();
+    const size_t S = this->number_of_supernodes();
+
+    // Update of the rows below each supernode, r x k
+    std::vector<double> tmp;
+    for(size_t s = 0; s < S; ++s){
+        const std::ptrdiff_t nc = this->columns(s);
+        const std::ptrdiff_t m = this->height(s);
+        const std::ptrdiff_t r = m - nc;
+        const double* L = this->Lx.data() + this->Lx_begin[s];
+        const std::ptrdiff_t* below = this->rows.data() + this->rows_begin[s] + nc;
+        double* ys = y + this->super_begin[s];
+
+        if(k == 1){
+            cblas_dtrsv(CblasColMajor, CblasLower, CblasNoTrans, CblasNonUnit, nc, L, m, ys, 1);
+        } else {
+            cblas_dtrsm(CblasColMajor, CblasLeft, CblasLower, CblasNoTrans, CblasNonUnit, nc, k, 1.0, L, m, ys, n);
+        }
+        if(r > 0){
+            tmp.resize(r*k);
+            if(k == 1){
+                cblas_dgemv(CblasColMajor, CblasNoTrans, r, nc, 1.0, L + nc, m, ys, 1, 0.0, tmp.data(), 1);
+            } else {
+                cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, r, k, nc, 1.0, L + nc, m, ys, n, 0.0, tmp.data(), r);
+            }
+            for(std::ptrdiff_t c = 0; c < k; ++c){
+                double* yc = y + c*n;
+                const double* tc = tmp.data() + c*r;
+                for(std::ptrdiff_t i = 0; i < r; ++i){
+                    yc[below[i]] -= tc[i];
+                }
+            }
+        }
+    }
+    for(size_t s = S; s-- > 0;){
+        const std::ptrdiff_t nc = this->columns(s);
+        const std::ptrdiff_t m = this->height(s);
+        const std::ptrdiff_t r = m - nc;
+        const double* L = this->Lx.data() + this->Lx_begin[s];
+        const std::ptrdiff_t* below = this->rows.data() + this->rows_begin[s] + nc;
+        double* ys = y + this->super_begin[s];
+
+        if(r > 0){
+            tmp.resize(r*k);
+            for(std::ptrdiff_t c = 0; c < k; ++c){
+                const double* yc = y + c*n;
+                double* tc = tmp.data() + c*r;
+                for(std::ptrdiff_t i = 0; i < r; ++i){
+                    tc[i] = yc[below[i]];
+                }
+            }
+            if(k == 1){
+                cblas_dgemv(CblasColMajor, CblasTrans, r, nc, -1.0, L + nc, m, tmp.data(), 1, 1.0, ys, 1);
+            } else {
+                cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, nc, k, r, -1.0, L + nc, m, tmp.data(), r, 1.0, ys, n);
+            }
+        }
+        if(k == 1){
+            cblas_dtrsv(CblasColMajor, CblasLower, CblasTrans, CblasNonUnit, nc, L, m, ys, 1);
+        } else {
+            cblas_dtrsm(CblasColMajor, CblasLeft, CblasLower, CblasTrans, CblasNonUnit, nc, k, 1.0, L, m, ys, n);
+        }
+    }
+}
+
+}
@@ -18,7 +18,9 @@
  *
  */
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <iomanip>
@@ -30,41 +32,59 @@
 
 namespace dplib{
 
+namespace{
+
+const sf::Uint8 BACKGROUND[]{201, 190, 210};
+
+// 5x7 glyphs, one byte per row from the top, bit 4 being the leftmost
+// pixel
+const char GLYPH_CHARS[] = "0123456789.-";
+const sf::Uint8 GLYPHS[][7]{
+    {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E},
+    {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E},
+    {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F},
+    {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E},
+    {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02},
+    {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E},
+    {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E},
+    {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08},
+    {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E},
+    {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C},
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C},
+    {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}
+};
+// Glyph width plus spacing, and height, before scaling
+const size_t GLYPH_ADVANCE = 6;
+const size_t GLYPH_HEIGHT = 7;
+const size_t TEXT_SCALE = 3;
+
+}
+
 void Window::save_image(){
-    sf::Vector2u windowSize = window.getSize();
+    if(!this->display){
+        size_t width, height;
+        std::vector<sf::Uint8> canvas;
+        this->render(canvas, width, height);
+        this->writer.write(this->image_filename(), width, height, std::move(canvas));
+        return;
+    }
+    sf::Vector2u windowSize = this->display->window.getSize();
     sf::Texture texture;
     texture.create(windowSize.x, windowSize.y);
-    texture.update(window);
+    texture.update(this->display->window);
     sf::Image screenshot = texture.copyToImage();
-    screenshot.saveToFile(this->name + ".png");
+    // Encoded in the background
+    const sf::Uint8* px = screenshot.getPixelsPtr();
+    this->writer.write(this->image_filename(), windowSize.x, windowSize.y, std::vector<sf::Uint8>(px, px + windowSize.x*windowSize.y*4));
 }
 
-Window::Window(size_t window_width, size_t window_height, size_t mesh_width, size_t mesh_height, std::string name):
+Window::Window(size_t window_width, size_t window_height, size_t mesh_width, size_t mesh_height, std::string name, Mode mode):
     window_width(window_width), window_height(window_height), W(mesh_width), H(mesh_height),
-    window(sf::VideoMode(window_width, window_height), "diffusion-problem - " + name),
     pixels(W*H*4, 255), name("diffusion-problem - " + name){
 
-    auto resolution = sf::VideoMode::getDesktopMode();
-
-    if(!this->font.loadFromFile("assets/LiberationSans-Regular.ttf")){
-        print_line("ERROR: font loading failed.");
-        exit(EXIT_FAILURE);
-    }
-    this->text_max.setFont(this->font);
-    this->text_max.setCharacterSize(30);
-    this->text_max.setFillColor(sf::Color::Black);
-    this->text_max.setStyle(sf::Text::Bold);
-
-    this->text_min.setFont(this->font);
-    this->text_min.setCharacterSize(30);
-    this->text_min.setFillColor(sf::Color::Black);
-    this->text_min.setStyle(sf::Text::Bold);
-
     this->legend_width = 30;
     this->legend_height = 400;
 
-    img.create(W, H);
-    this->sprite.setTexture(this->img);
     switch(this->colormap){
         case ColorMap::GRAYSCALE:
             this->legend_grayscale();
@@ -73,13 +93,42 @@ Window::Window(size_t window_width, size_t window_height, size_t mesh_width, siz
             // TODO
             break;
     }
+    if(mode == Mode::HEADLESS){
+        return;
+    }
+
+    this->display.reset(new Display());
+    auto& d = *this->display;
+    d.window.create(sf::VideoMode(window_width, window_height), this->name);
+
+    auto resolution = sf::VideoMode::getDesktopMode();
+
+    if(!d.font.loadFromFile("assets/LiberationSans-Regular.ttf")){
+        print_line("ERROR: font loading failed.");
+        exit(EXIT_FAILURE);
+    }
+    d.text_max.setFont(d.font);
+    d.text_max.setCharacterSize(30);
+    d.text_max.setFillColor(sf::Color::Black);
+    d.text_max.setStyle(sf::Text::Bold);
+
+    d.text_min.setFont(d.font);
+    d.text_min.setCharacterSize(30);
+    d.text_min.setFillColor(sf::Color::Black);
+    d.text_min.setStyle(sf::Text::Bold);
+
+    d.img.create(W, H);
+    d.sprite.setTexture(d.img);
+    d.legend_img.create(legend_width, legend_height);
+    d.legend_img.update(this->legend_pixels.data());
+    d.legend.setTexture(d.legend_img);
 
     size_t offset = (window_width - W - legend_width)/3;
 
     //sprite.setPosition(sf::Vector2f(window_width/2-W/2, window_height/2-H/2));
-    sprite.setPosition(sf::Vector2f(2*offset + legend_width, window_height/2-H/2));
-    this->legend.setPosition(sf::Vector2f(offset, window_height/2-legend_height/2));
-    window.setPosition(sf::Vector2i((resolution.width - window_width)/2, (resolution.height - window_height)/2));
+    d.sprite.setPosition(sf::Vector2f(2*offset + legend_width, window_height/2-H/2));
+    d.legend.setPosition(sf::Vector2f(offset, window_height/2-legend_height/2));
+    d.window.setPosition(sf::Vector2i((resolution.width - window_width)/2, (resolution.height - window_height)/2));
 }
 
 void Window::update(const std::vector<double>& mesh){
@@ -101,32 +150,24 @@ void Window::update(const std::vector<double>& mesh, const double min_x, const d
 }
 
 void Window::update(){
+    if(!this->display){
+        return;
+    }
+    auto& d = *this->display;
     sf::Event event;
-    size_t offset = (window_width - W - legend_width)/3;
-    while (window.pollEvent(event)){
+    while (d.window.pollEvent(event)){
         if (event.type == sf::Event::Closed){
             this->save_image();
-            window.close();
+            d.window.close();
         }
         if(event.type == sf::Event::Resized){
             sf::FloatRect view(0, 0, event.size.width, event.size.height);
-            window.setView(sf::View(view));
+            d.window.setView(sf::View(view));
             window_width = event.size.width;
      
             window_height = event.size.height;
 
-            sprite.setPosition(sf::Vector2f(2*offset + legend_width, window_height/2-H/2));
-            this->legend.setPosition(sf::Vector2f(offset, window_height/2-legend_height/2));
-
-            this->text_max.setPosition(offset + legend_width/2 - text_max.getGlobalBounds().width/2, window_height/2 - legend_height/2 - text_max.getGlobalBounds().height - 16);
-            this->text_min.setPosition(offset + legend_width/2 - text_min.getGlobalBounds().width/2, window_height/2 + legend_height/2);
-            window.clear(sf::Color(201,190,210));
-
-            window.draw(sprite);
-            window.draw(legend);
-            window.draw(text_max);
-            window.draw(text_min);
-            window.display();
+            this->redraw();
         }
     }
 }
@@ -134,25 +175,94 @@ void Window::update(){
 void Window::update(const double min_x, const double max_x){
     std::stringstream stream;
     stream << std::fixed << std::setprecision(3) << min_x;
-    std::string s = stream.str();
-    this->text_min.setString(s);
+    this->label_min = stream.str();
     stream.str(std::string());
     stream << std::fixed << std::setprecision(3) << max_x;
-    s = stream.str();
-    this->text_max.setString(s);
+    this->label_max = stream.str();
 
+    if(!this->display){
+        // Written straight from the pixels, without waiting on encoding
+        this->save_image();
+        return;
+    }
+    this->display->text_min.setString(this->label_min);
+    this->display->text_max.setString(this->label_max);
+    this->display->img.update(this->pixels.data());
+    this->redraw();
+}
+
+void Window::redraw(){
+    auto& d = *this->display;
     size_t offset = (window_width - W - legend_width)/3;
-    this->text_max.setPosition(offset + legend_width/2 - text_max.getGlobalBounds().width/2, window_height/2 - legend_height/2 - text_max.getGlobalBounds().height - 16);
-    this->text_min.setPosition(offset + legend_width/2 - text_min.getGlobalBounds().width/2, window_height/2 + legend_height/2);
-    window.clear(sf::Color(201,190,210));
 
-    img.update(this->pixels.data());
+    d.sprite.setPosition(sf::Vector2f(2*offset + legend_width, window_height/2-H/2));
+    d.legend.setPosition(sf::Vector2f(offset, window_height/2-legend_height/2));
+
+    d.text_max.setPosition(offset + legend_width/2 - d.text_max.getGlobalBounds().width/2, window_height/2 - legend_height/2 - d.text_max.getGlobalBounds().height - 16);
+    d.text_min.setPosition(offset + legend_width/2 - d.text_min.getGlobalBounds().width/2, window_height/2 + legend_height/2);
+    d.window.clear(sf::Color(BACKGROUND[0], BACKGROUND[1], BACKGROUND[2]));
+
+    d.window.draw(d.sprite);
+    d.window.draw(d.legend);
+    d.window.draw(d.text_max);
+    d.window.draw(d.text_min);
+    d.window.display();
+}
 
-    window.draw(sprite);
-    window.draw(legend);
-    window.draw(text_max);
-    window.draw(text_min);
-    window.display();
+void Window::render(std::vector<sf::Uint8>& canvas, size_t& width, size_t& height) const{
+    const size_t text_height = GLYPH_HEIGHT*TEXT_SCALE;
+    const auto text_width = [](const std::string& s){
+        return s.empty() ? 0 : (s.size()*GLYPH_ADVANCE - 1)*TEXT_SCALE;
+    };
+    const size_t label_width = std::max(text_width(this->label_min), text_width(this->label_max));
+    // Grown if the mesh or the legend and its labels do not fit in the
+    // window
+    width = std::max(this->window_width, W + legend_width + 3*(label_width/2 + 1));
+    height = std::max(this->window_height, std::max(H, legend_height + 2*(text_height + 16)));
+
+    canvas.resize(width*height*4);
+    for(size_t i = 0; i < width*height; ++i){
+        canvas[i*4+0] = BACKGROUND[0];
+        canvas[i*4+1] = BACKGROUND[1];
+        canvas[i*4+2] = BACKGROUND[2];
+        canvas[i*4+3] = 255;
+    }
+    const auto blit = [&](const std::vector<sf::Uint8>& px, size_t w, size_t h, size_t x0, size_t y0){
+        for(size_t y = 0; y < h; ++y){
+            std::copy(px.begin() + y*w*4, px.begin() + (y+1)*w*4, canvas.begin() + ((y0 + y)*width + x0)*4);
+        }
+    };
+    const size_t offset = (width - W - legend_width)/3;
+    const size_t legend_top = height/2 - legend_height/2;
+    blit(this->pixels, W, H, 2*offset + legend_width, height/2 - H/2);
+    blit(this->legend_pixels, legend_width, legend_height, offset, legend_top);
+
+    const size_t center = offset + legend_width/2;
+    draw_text(canvas, width, center - std::min(center, text_width(this->label_max)/2), legend_top - text_height - 16, this->label_max, TEXT_SCALE);
+    draw_text(canvas, width, center - std::min(center, text_width(this->label_min)/2), legend_top + legend_height + 16, this->label_min, TEXT_SCALE);
+}
+
+void Window::draw_text(std::vector<sf::Uint8>& canvas, size_t width, size_t x, size_t y, const std::string& s, size_t scale){
+    const size_t height = canvas.size()/(width*4);
+    for(size_t c = 0; c < s.size(); ++c){
+        const char* g = std::strchr(GLYPH_CHARS, s[c]);
+        if(s[c] == '\0' || g == nullptr){
+            continue;
+        }
+        const sf::Uint8* glyph = GLYPHS[g - GLYPH_CHARS];
+        for(size_t gy = 0; gy < GLYPH_HEIGHT*scale; ++gy){
+            for(size_t gx = 0; gx < 5*scale; ++gx){
+                const size_t px = x + c*GLYPH_ADVANCE*scale + gx;
+                const size_t py = y + gy;
+                if(px >= width || py >= height || !(glyph[gy/scale] & (0x10 >> (gx/scale)))){
+                    continue;
+                }
+                canvas[(py*width + px)*4+0] = 0;
+                canvas[(py*width + px)*4+1] = 0;
+                canvas[(py*width + px)*4+2] = 0;
+            }
+        }
+    }
 }
 
 void Window::to_grayscale(const std::vector<double>& mesh, const double min_x, const double max_x){
@@ -190,8 +300,8 @@ void Window::to_hsv(const std::vector<double>& mesh, const double min_x, const d
 }
 
 void Window::legend_grayscale(){
-    std::vector<sf::Uint8> px(legend_width*legend_height*4, 255);
-    this->legend_img.create(legend_width, legend_height);
+    std::vector<sf::Uint8>& px = this->legend_pixels;
+    px.assign(legend_width*legend_height*4, 255);
     #pragma omp parallel for
     for(size_t y = 0; y < legend_height; ++y){
         const sf::Uint8 p = 255.0*static_cast<double>(y)/legend_height;
@@ -201,8 +311,6 @@ void Window::legend_grayscale(){
             }
         }
     }
-    this->legend_img.update(px.data());
-    this->legend.setTexture(this->legend_img);
 }
 
 }
@@ -20,11 +20,12 @@
 
 #include <algorithm>
 #include <cblas.h>
+#include <string>
 #include "lib/print.hpp"
 #include "lib/window.hpp"
 #include "lib/mesh.hpp"
 
-int main(){
+int main(int argc, char* argv[]){
     Eigen::initParallel();
 
     dplib::print_line("Launching window...");
@@ -38,7 +39,9 @@ int main(){
 
     const double K_MIN = 1e-9;
 
-    dplib::Window window(window_width, window_height, W, H, "test1 - psi");
+    // --headless only writes the image, without opening a window
+    const bool headless = argc > 1 && std::string(argv[1]) == "--headless";
+    dplib::Window window(window_width, window_height, W, H, "test1 - psi", headless ? dplib::Window::Mode::HEADLESS : dplib::Window::Mode::INTERACTIVE);
 
     dplib::print_line("Creating mesh...");
     dplib::RectangularMesh mesh(W, H, 1.0, E_SIZE);
@@ -0,0 +1,92 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <mpi.h>
+#include "lib/distributed_mesh.hpp"
+#include "lib/mesh.hpp"
+#include "lib/print.hpp"
+
+// test2 on a DistributedMesh, without a window. With `check`, rank 0 also
+// solves the problem with RectangularMesh and prints the largest
+// difference between the results.
+// Usage: mpirun -np 4 test2_mpi [W] [H] [schwarz] [overlap] [check]
+int main(int argc, char* argv[]){
+    MPI_Init(&argc, &argv);
+
+    const size_t W = (argc > 1) ? std::atol(argv[1]) : 400;
+    const size_t H = (argc > 2) ? std::atol(argv[2]) : W;
+    // Points take doubles
+    const double Wd = W, Hd = H;
+    const bool schwarz = (argc > 3) ? std::atoi(argv[3]) != 0 : true;
+    const size_t overlap = (argc > 4) ? std::atol(argv[4]) : 2;
+    const bool check = (argc > 5) ? std::atoi(argv[5]) != 0 : true;
+
+    const double K_MIN = 1e-9;
+
+    {
+        dplib::DistributedMesh mesh(MPI_COMM_WORLD, W, H, 1.0, 1.0);
+        const bool root = mesh.rank() == 0;
+
+        mesh.apply_Dirichlet(0, {0,0,0}, {0,Hd+1,0});
+        mesh.apply_Neumann(1, {Wd+1,0,0}, {Wd+1,Hd+1,0});
+        mesh.set_schwarz(schwarz);
+        mesh.set_overlap(overlap);
+
+        double t = MPI_Wtime();
+        mesh.generate_K(K_MIN);
+        const double assembly = MPI_Wtime() - t;
+        t = MPI_Wtime();
+        mesh.solve();
+        const double solve = MPI_Wtime() - t;
+
+        auto result = mesh.get_result();
+        if(root){
+            std::cout << mesh.size() << " ranks, " << (schwarz ? "Schwarz" : "Jacobi") << ": " << mesh.iterations()
+                      << " iterations, error " << mesh.error() << std::endl;
+            std::cout << "assembly " << assembly << " s, solve " << solve << " s" << std::endl;
+            std::cout << *std::min_element(result.begin(), result.end()) << " "
+                      << *std::max_element(result.begin(), result.end()) << std::endl;
+
+            if(check){
+                dplib::RectangularMesh serial(W, H, 1.0, 1.0);
+                serial.apply_Dirichlet(0, {0,0,0}, {0,Hd+1,0});
+                serial.apply_Neumann(1, {Wd+1,0,0}, {Wd+1,Hd+1,0});
+                serial.generate_K(K_MIN);
+                serial.solve();
+                const auto expected = serial.get_result();
+                double diff = 0, scale = 0;
+                for(size_t i = 0; i < expected.size(); ++i){
+                    diff = std::max(diff, std::abs(result[i] - expected[i]));
+                    scale = std::max(scale, std::abs(expected[i]));
+                }
+                std::cout << "max difference to RectangularMesh: " << diff << " (" << diff/scale << " relative)" << std::endl;
+            }
+        }
+    }
+
+    MPI_Finalize();
+
+    return 0;
+}
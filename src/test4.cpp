@@ -20,12 +20,13 @@
 
 #include <algorithm>
 #include <cblas.h>
+#include <string>
 #include "lib/print.hpp"
 #include "lib/window.hpp"
 #include "lib/mesh.hpp"
 #include "lib/sparse_matrix.hpp"
 
-int main(){
+int main(int argc, char* argv[]){
     Eigen::initParallel();
 
     dplib::print_line("Launching window...");
@@ -40,7 +41,9 @@ int main(){
     const double K_MIN = 0;
     const double I_MIN = 1e-9;
 
-    dplib::Window window(window_width, window_height, W, H, "test4 - psi");
+    // --headless only writes the image, without opening a window
+    const bool headless = argc > 1 && std::string(argv[1]) == "--headless";
+    dplib::Window window(window_width, window_height, W, H, "test4 - psi", headless ? dplib::Window::Mode::HEADLESS : dplib::Window::Mode::INTERACTIVE);
 
     dplib::print_line("Creating mesh...");
     dplib::RectangularMesh mesh(W, H, 1.0, E_SIZE);
@@ -51,9 +54,7 @@ int main(){
     dplib::print_line("Generating global matrix...");
     mesh.generate_K(K_MIN);
 
-    for(size_t i = 0; i < mesh.matrix_size(); ++i){
-        mesh.K.add(i, i, I_MIN);
-    }
+    mesh.K.shift_diagonal(I_MIN);
 
     dplib::print_line("Solving linear equation...");
     mesh.solve();
@@ -0,0 +1,139 @@
+/*
+ *   Copyright (C) 2023 Tarcísio Ladeia de Oliveira.
+ *
+ *   This file is part of diffusion-problem
+ *
+ *   diffusion-problem is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   diffusion-problem is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with diffusion-problem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "lib/print.hpp"
+#include "lib/sparse_matrix.hpp"
+
+// SparseMatrix::multiply() must give the same product whether the entries
+// are in the compressed pattern or in the hash map, and with either one or
+// both triangles stored in the hash map
+
+namespace{
+
+const size_t N = 8;
+
+// Element matrix of element e of a chain of N nodes
+std::vector<double> element(size_t e){
+    const double k = e + 1;
+    return {2*k, -k,
+            -k, 2*k};
+}
+
+std::vector<std::vector<double>> dense_chain(){
+    std::vector<std::vector<double>> A(N, std::vector<double>(N, 0));
+    for(size_t e = 0; e + 1 < N; ++e){
+        const auto M = element(e);
+        for(size_t i = 0; i < 2; ++i){
+            for(size_t j = 0; j < 2; ++j){
+                A[e+i][e+j] += M[i*2 + j];
+            }
+        }
+    }
+    return A;
+}
+
+dplib::SparseMatrix pattern_chain(){
+    std::vector<size_t> element_nodes;
+    for(size_t e = 0; e + 1 < N; ++e){
+        element_nodes.push_back(e);
+        element_nodes.push_back(e+1);
+    }
+    std::vector<long> mapping(N);
+    for(size_t i = 0; i < N; ++i){
+        mapping[i] = i;
+    }
+    dplib::SparseMatrix K;
+    K.generate_pattern(element_nodes, mapping, 2, 1, N);
+    for(size_t e = 0; e + 1 < N; ++e){
+        K.insert_element_matrix(e, element(e));
+    }
+    return K;
+}
+
+bool check(const std::string& name, const dplib::SparseMatrix& K, const std::vector<std::vector<double>>& A){
+    std::vector<double> x(N);
+    for(size_t i = 0; i < N; ++i){
+        x[i] = std::sin(1.0 + i);
+    }
+    const auto y = K.multiply(x);
+    double diff = 0;
+    for(size_t i = 0; i < N; ++i){
+        double yi = 0;
+        for(size_t j = 0; j < N; ++j){
+            yi += A[i][j]*x[j];
+        }
+        diff = std::max(diff, std::abs(y[i] - yi));
+    }
+    if(diff > 1e-12){
+        dplib::print_line("ERROR: " + name + ": product differs by " + std::to_string(diff) + ".");
+        return false;
+    }
+    return true;
+}
+
+}
+
+int main(){
+    auto A = dense_chain();
+    bool ok = true;
+
+    // Compressed pattern only (lower triangle)
+    ok = check("pattern", pattern_chain(), A) && ok;
+
+    // Hash map, full element matrices
+    {
+        dplib::SparseMatrix K;
+        for(size_t e = 0; e + 1 < N; ++e){
+            K.insert_matrix(element(e), {static_cast<long>(e), static_cast<long>(e+1)});
+        }
+        ok = check("hash map, both triangles", K, A) && ok;
+    }
+
+    // Hash map, lower triangle only
+    {
+        dplib::SparseMatrix K;
+        for(size_t e = 0; e + 1 < N; ++e){
+            const auto M = element(e);
+            K.add(e, e, M[0]);
+            K.add(e+1, e, M[2]);
+            K.add(e+1, e+1, M[3]);
+        }
+        ok = check("hash map, lower triangle", K, A) && ok;
+    }
+
+    // Pattern, plus couplings outside of it that fall back to the hash
+    // map, given in either triangle
+    A[N-1][0] += 0.5;
+    A[0][N-1] += 0.5;
+    A[N-2][1] += 0.25;
+    A[1][N-2] += 0.25;
+    {
+        auto K = pattern_chain();
+        K.add(N-1, 0, 0.5);
+        K.add(1, N-2, 0.25);
+        ok = check("pattern and hash map", K, A) && ok;
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}